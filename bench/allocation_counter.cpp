@@ -0,0 +1,103 @@
+#include <bench/harness.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+
+// glibc entry points of its allocator, used by the interposed functions below.
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+void* __libc_memalign(size_t alignment, size_t size);
+}
+
+namespace NBenchmark {
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+// Threads count into slots of their own where possible, so counting does not
+// add a contended cache line to the scenarios being measured.
+constexpr size_t CounterSlotCount = 64;
+
+struct alignas(64) TCounterSlot {
+    std::atomic<uint64_t> Count{0};
+};
+
+TCounterSlot CounterSlots[CounterSlotCount];
+std::atomic<size_t> NextCounterSlot{0};
+
+// Plain data, so looking it up never allocates by itself.
+thread_local size_t CurrentCounterSlot = CounterSlotCount;
+
+void CountAllocation() {
+    if (CurrentCounterSlot == CounterSlotCount) {
+        CurrentCounterSlot = NextCounterSlot.fetch_add(1, std::memory_order_relaxed) % CounterSlotCount;
+    }
+    CounterSlots[CurrentCounterSlot].Count.fetch_add(1, std::memory_order_relaxed);
+}
+
+} // namespace
+
+uint64_t GetAllocationCount() {
+    uint64_t count = 0;
+    for (const auto& slot : CounterSlots) {
+        count += slot.Count.load(std::memory_order_relaxed);
+    }
+    return count;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NBenchmark
+
+////////////////////////////////////////////////////////////////////////////////
+
+// The allocation functions of the C library, interposed so that both operator
+// new and the std::aligned_alloc of New<T> are counted.
+
+extern "C" {
+
+void* malloc(size_t size) {
+    NBenchmark::CountAllocation();
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size) {
+    NBenchmark::CountAllocation();
+    return __libc_calloc(count, size);
+}
+
+void* realloc(void* ptr, size_t size) {
+    NBenchmark::CountAllocation();
+    return __libc_realloc(ptr, size);
+}
+
+void* aligned_alloc(size_t alignment, size_t size) {
+    NBenchmark::CountAllocation();
+    return __libc_memalign(alignment, size);
+}
+
+void* memalign(size_t alignment, size_t size) {
+    NBenchmark::CountAllocation();
+    return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void** ptr, size_t alignment, size_t size) {
+    if (alignment % sizeof(void*) != 0 || (alignment & (alignment - 1)) != 0) {
+        return EINVAL;
+    }
+    NBenchmark::CountAllocation();
+    void* result = __libc_memalign(alignment, size);
+    if (!result) {
+        return ENOMEM;
+    }
+    *ptr = result;
+    return 0;
+}
+
+} // extern "C"
+
+////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,107 @@
+#include <bench/harness.h>
+
+#include <common/atomic_intrusive_ptr.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace NBenchmark {
+
+using namespace NCommon;
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+struct TSnapshot
+    : public NRefCounted::TRefCountedBase
+{
+    explicit TSnapshot(uint64_t version)
+        : Version(version)
+    { }
+
+    const uint64_t Version;
+};
+
+enum class EReadMode {
+    Guard,
+    Acquire,
+};
+
+// Every thread reads its share of the operations from one shared holder.
+// With |writer| set, an extra thread keeps publishing new snapshots meanwhile.
+void ConcurrentReads(TBenchmarkState& state, EReadMode mode, bool writer) {
+    TAtomicIntrusivePtr<TSnapshot> holder(New<TSnapshot>(0));
+    const size_t readerCount = state.GetThreadCount();
+    std::atomic<bool> go{false};
+    std::atomic<bool> stop{false};
+    std::atomic<uint64_t> checksum{0};
+
+    std::vector<std::thread> readers;
+    for (size_t reader = 0; reader < readerCount; ++reader) {
+        const uint64_t count = state.GetOperationCount() / readerCount +
+            (reader < state.GetOperationCount() % readerCount ? 1 : 0);
+        readers.emplace_back([&, count] {
+            while (!go.load(std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
+            uint64_t sum = 0;
+            for (uint64_t index = 0; index < count; ++index) {
+                if (mode == EReadMode::Guard) {
+                    sum += holder.Read()->Version;
+                } else {
+                    sum += holder.Acquire()->Version;
+                }
+            }
+            checksum.fetch_add(sum, std::memory_order_relaxed);
+        });
+    }
+
+    std::thread updater;
+    uint64_t updates = 0;
+    if (writer) {
+        updater = std::thread([&] {
+            while (!go.load(std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
+            while (!stop.load(std::memory_order_relaxed)) {
+                holder.Store(New<TSnapshot>(++updates));
+                std::this_thread::yield();
+            }
+        });
+    }
+
+    state.StartTimer();
+    go.store(true, std::memory_order_release);
+    for (auto& reader : readers) {
+        reader.join();
+    }
+    state.StopTimer();
+
+    stop.store(true, std::memory_order_relaxed);
+    if (updater.joinable()) {
+        updater.join();
+        state.SetCounter("updates", updates);
+    }
+}
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////
+
+void RegisterAtomicIntrusivePtrBenchmarks(TBenchmarkRunner& runner) {
+    runner.Register("atomic_intrusive_ptr/read_guard", 10'000'000, [] (TBenchmarkState& state) {
+        ConcurrentReads(state, EReadMode::Guard, false);
+    });
+    runner.Register("atomic_intrusive_ptr/acquire", 10'000'000, [] (TBenchmarkState& state) {
+        ConcurrentReads(state, EReadMode::Acquire, false);
+    });
+    runner.Register("atomic_intrusive_ptr/guard_with_writer", 10'000'000, [] (TBenchmarkState& state) {
+        ConcurrentReads(state, EReadMode::Guard, true);
+    });
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NBenchmark
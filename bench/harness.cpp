@@ -0,0 +1,204 @@
+#include <bench/harness.h>
+
+#include <cmath>
+#include <iomanip>
+#include <numeric>
+
+namespace NBenchmark {
+
+////////////////////////////////////////////////////////////////////////////////
+
+TBenchmarkState::TBenchmarkState(uint64_t operationCount, size_t threadCount)
+    : OperationCount_(operationCount)
+    , ThreadCount_(threadCount)
+{ }
+
+uint64_t TBenchmarkState::GetOperationCount() const {
+    return OperationCount_;
+}
+
+size_t TBenchmarkState::GetThreadCount() const {
+    return ThreadCount_;
+}
+
+void TBenchmarkState::StartTimer() {
+    TimerStarted_ = true;
+    StartAllocations_ = GetAllocationCount();
+    Start_ = TClock::now();
+}
+
+void TBenchmarkState::StopTimer() {
+    Stop_ = TClock::now();
+    StopAllocations_ = GetAllocationCount();
+    TimerStopped_ = true;
+}
+
+void TBenchmarkState::RecordLatency(std::chrono::nanoseconds latency) {
+    Latencies_.push_back(std::max<int64_t>(latency.count(), 0));
+}
+
+void TBenchmarkState::SetCounter(const std::string& name, double value) {
+    Counters_[name] = value;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+double TBenchmarkResult::GetMedianOpsPerSecond() const {
+    if (OpsPerSecond.empty()) {
+        return 0.0;
+    }
+    auto sorted = OpsPerSecond;
+    std::sort(sorted.begin(), sorted.end());
+    return sorted[sorted.size() / 2];
+}
+
+uint64_t TBenchmarkResult::GetLatencyPercentile(double quantile) const {
+    if (Latencies.empty()) {
+        return 0;
+    }
+    auto rank = static_cast<size_t>(std::ceil(quantile * Latencies.size()));
+    return Latencies[std::clamp<size_t>(rank, 1, Latencies.size()) - 1];
+}
+
+NJson::TJsonNode TBenchmarkResult::ToJson() const {
+    NJson::TJsonNode result;
+    result["name"] = Name;
+    result["operations"] = Operations;
+    result["repetitions"] = OpsPerSecond.size();
+
+    NJson::TJsonNode opsPerSecond;
+    if (!OpsPerSecond.empty()) {
+        auto [min, max] = std::minmax_element(OpsPerSecond.begin(), OpsPerSecond.end());
+        opsPerSecond["median"] = GetMedianOpsPerSecond();
+        opsPerSecond["min"] = *min;
+        opsPerSecond["max"] = *max;
+        opsPerSecond["mean"] = std::accumulate(OpsPerSecond.begin(), OpsPerSecond.end(), 0.0) / OpsPerSecond.size();
+    }
+    result["ops_per_sec"] = std::move(opsPerSecond);
+
+    NJson::TJsonNode latency;
+    latency["samples"] = Latencies.size();
+    latency["mean"] = Latencies.empty()
+        ? 0.0
+        : std::accumulate(Latencies.begin(), Latencies.end(), 0.0) / Latencies.size();
+    latency["p50"] = GetLatencyPercentile(0.5);
+    latency["p99"] = GetLatencyPercentile(0.99);
+    latency["p999"] = GetLatencyPercentile(0.999);
+    latency["max"] = Latencies.empty() ? 0 : Latencies.back();
+    result["latency_ns"] = std::move(latency);
+
+    NJson::TJsonNode counters = std::unordered_map<std::string, NJson::TJsonNode>();
+    for (const auto& [name, value] : Counters) {
+        counters[name] = value;
+    }
+    result["counters"] = std::move(counters);
+    return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+TBenchmarkRunner::TBenchmarkRunner(TBenchmarkOptions options)
+    : Options_(std::move(options))
+{ }
+
+void TBenchmarkRunner::Register(std::string name, uint64_t operationCount, TBenchmarkBody body) {
+    auto scaled = static_cast<uint64_t>(operationCount * Options_.Scale);
+    Benchmarks_.push_back({std::move(name), std::max<uint64_t>(scaled, 1), std::move(body)});
+}
+
+std::vector<TBenchmarkResult> TBenchmarkRunner::Run(std::ostream& out) const {
+    std::vector<TBenchmarkResult> results;
+    for (const auto& benchmark : Benchmarks_) {
+        if (benchmark.Name.find(Options_.Filter) == std::string::npos) {
+            continue;
+        }
+
+        auto result = RunBenchmark(benchmark);
+        out << std::left << std::setw(40) << result.Name << std::right << std::fixed << std::setprecision(0)
+            << std::setw(14) << result.GetMedianOpsPerSecond() << " ops/s"
+            << "  p50 " << std::setw(10) << result.GetLatencyPercentile(0.5) << " ns"
+            << "  p99 " << std::setw(10) << result.GetLatencyPercentile(0.99) << " ns"
+            << "  p999 " << std::setw(10) << result.GetLatencyPercentile(0.999) << " ns";
+        for (const auto& [name, value] : result.Counters) {
+            out << "  " << name << " " << std::setprecision(1) << value;
+        }
+        out << std::endl;
+        results.push_back(std::move(result));
+    }
+    return results;
+}
+
+NJson::TJsonNode TBenchmarkRunner::ToJson(const std::vector<TBenchmarkResult>& results) const {
+    NJson::TJsonNode context;
+    context["threads"] = Options_.ThreadCount;
+    context["warmup_repetitions"] = Options_.WarmupRepetitions;
+    context["repetitions"] = Options_.Repetitions;
+    context["scale"] = Options_.Scale;
+
+    NJson::TJsonNode benchmarks = std::vector<NJson::TJsonNode>();
+    for (const auto& result : results) {
+        benchmarks.push_back(result.ToJson());
+    }
+
+    NJson::TJsonNode result;
+    result["context"] = std::move(context);
+    result["benchmarks"] = std::move(benchmarks);
+    return result;
+}
+
+const TBenchmarkOptions& TBenchmarkRunner::GetOptions() const {
+    return Options_;
+}
+
+TBenchmarkResult TBenchmarkRunner::RunBenchmark(const TBenchmark& benchmark) const {
+    TBenchmarkResult result;
+    result.Name = benchmark.Name;
+    result.Operations = benchmark.OperationCount;
+
+    std::vector<uint64_t> perOperation;
+    const size_t runs = Options_.WarmupRepetitions + std::max<size_t>(Options_.Repetitions, 1);
+    for (size_t run = 0; run < runs; ++run) {
+        TBenchmarkState state(benchmark.OperationCount, Options_.ThreadCount);
+        auto startAllocations = GetAllocationCount();
+        auto start = TBenchmarkState::TClock::now();
+        benchmark.Body(state);
+        auto stop = TBenchmarkState::TClock::now();
+        auto stopAllocations = GetAllocationCount();
+
+        if (run < Options_.WarmupRepetitions) {
+            continue;
+        }
+
+        if (state.TimerStarted_) {
+            start = state.Start_;
+            startAllocations = state.StartAllocations_;
+        }
+        if (state.TimerStopped_) {
+            stop = state.Stop_;
+            stopAllocations = state.StopAllocations_;
+        }
+        double seconds = std::chrono::duration<double>(stop - start).count();
+        result.OpsPerSecond.push_back(benchmark.OperationCount / std::max(seconds, 1e-9));
+        perOperation.push_back(static_cast<uint64_t>(seconds * 1e9 / benchmark.OperationCount));
+
+        result.Latencies.insert(result.Latencies.end(), state.Latencies_.begin(), state.Latencies_.end());
+        for (const auto& [name, value] : state.Counters_) {
+            result.Counters[name] += value;
+        }
+        result.Counters["allocations_per_op"] +=
+            static_cast<double>(stopAllocations - startAllocations) / benchmark.OperationCount;
+    }
+
+    for (auto& [name, value] : result.Counters) {
+        value /= result.OpsPerSecond.size();
+    }
+    if (result.Latencies.empty()) {
+        result.Latencies = std::move(perOperation);
+    }
+    std::sort(result.Latencies.begin(), result.Latencies.end());
+    return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NBenchmark
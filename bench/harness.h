@@ -0,0 +1,148 @@
+#pragma once
+
+#include <common/json.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace NBenchmark {
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Handed to a benchmark body for one run.
+class TBenchmarkState {
+public:
+    using TClock = std::chrono::steady_clock;
+
+    TBenchmarkState(uint64_t operationCount, size_t threadCount);
+
+    // Operations the body has to perform; ops/sec is computed from it.
+    uint64_t GetOperationCount() const;
+
+    // Threads the scenario should spread its work over.
+    size_t GetThreadCount() const;
+
+    // Setup before StartTimer and teardown after StopTimer are not measured;
+    // a body that calls neither is timed as a whole.
+    void StartTimer();
+    void StopTimer();
+
+    // Latency of a single operation; only from the thread running the body.
+    void RecordLatency(std::chrono::nanoseconds latency);
+
+    // Scenario-specific figure such as CPU time per operation; averaged over
+    // the repetitions.
+    void SetCounter(const std::string& name, double value);
+
+private:
+    friend class TBenchmarkRunner;
+
+    const uint64_t OperationCount_;
+    const size_t ThreadCount_;
+    TClock::time_point Start_;
+    TClock::time_point Stop_;
+    uint64_t StartAllocations_ = 0;
+    uint64_t StopAllocations_ = 0;
+    bool TimerStarted_ = false;
+    bool TimerStopped_ = false;
+    std::vector<uint64_t> Latencies_;
+    std::map<std::string, double> Counters_;
+};
+
+using TBenchmarkBody = std::function<void(TBenchmarkState&)>;
+
+struct TBenchmarkOptions {
+    // Runs thrown away before measuring: they warm up caches, the allocator
+    // and lazily started threads.
+    size_t WarmupRepetitions = 1;
+    size_t Repetitions = 5;
+
+    // Only benchmarks whose name contains Filter run.
+    std::string Filter;
+
+    size_t ThreadCount = std::max(1u, std::thread::hardware_concurrency());
+
+    // Multiplies the operation count of every benchmark, e.g. 0.1 for a
+    // quick smoke run.
+    double Scale = 1.0;
+};
+
+struct TBenchmarkResult {
+    std::string Name;
+    uint64_t Operations = 0;
+    // One per measured repetition.
+    std::vector<double> OpsPerSecond;
+    // Sorted, in nanoseconds: the recorded samples if the body recorded any,
+    // otherwise the mean time per operation of every repetition.
+    std::vector<uint64_t> Latencies;
+    // Set by the bodies, plus "allocations_per_op": heap allocations of all
+    // threads over the measured part of a run, per operation.
+    std::map<std::string, double> Counters;
+
+    double GetMedianOpsPerSecond() const;
+
+    // Nearest-rank percentile; 0 without samples.
+    uint64_t GetLatencyPercentile(double quantile) const;
+
+    // {"name", "operations", "repetitions",
+    //  "ops_per_sec": {"median", "min", "max", "mean"},
+    //  "latency_ns": {"samples", "mean", "p50", "p99", "p999", "max"},
+    //  "counters": {...}}.
+    NJson::TJsonNode ToJson() const;
+};
+
+// Minimal benchmark harness: every benchmark is run WarmupRepetitions times
+// unmeasured and then Repetitions times measured, each run doing the
+// registered number of operations.
+class TBenchmarkRunner {
+public:
+    explicit TBenchmarkRunner(TBenchmarkOptions options);
+
+    void Register(std::string name, uint64_t operationCount, TBenchmarkBody body);
+
+    // Runs matching benchmarks in registration order and prints a line for
+    // each to |out|.
+    std::vector<TBenchmarkResult> Run(std::ostream& out) const;
+
+    // {"context": {...}, "benchmarks": [...]}.
+    NJson::TJsonNode ToJson(const std::vector<TBenchmarkResult>& results) const;
+
+    const TBenchmarkOptions& GetOptions() const;
+
+private:
+    struct TBenchmark {
+        std::string Name;
+        uint64_t OperationCount;
+        TBenchmarkBody Body;
+    };
+
+    TBenchmarkResult RunBenchmark(const TBenchmark& benchmark) const;
+
+    const TBenchmarkOptions Options_;
+    std::vector<TBenchmark> Benchmarks_;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Heap allocations made by all threads so far, counted by the malloc family
+// that allocation_counter.cpp interposes (glibc only).
+uint64_t GetAllocationCount();
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Scenario sets, registered by main.
+void RegisterThreadPoolBenchmarks(TBenchmarkRunner& runner);
+void RegisterAtomicIntrusivePtrBenchmarks(TBenchmarkRunner& runner);
+void RegisterPeriodicExecutorBenchmarks(TBenchmarkRunner& runner);
+void RegisterRefCountedBenchmarks(TBenchmarkRunner& runner);
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NBenchmark
@@ -0,0 +1,84 @@
+#include <bench/harness.h>
+
+#include <common/getopts.h>
+
+#include <fstream>
+#include <iostream>
+
+using namespace NBenchmark;
+
+////////////////////////////////////////////////////////////////////////////////
+
+class TBenchmarkOpts
+    : public NCommon::GetOpts
+{
+public:
+    TBenchmarkOptions Options;
+    std::string JsonPath;
+
+    void Register() override {
+        SetDescription("Benchmarks of the thread pool, invokers, periodic executors, "
+            "atomic intrusive pointers and refcounted allocation. Build with -DCMAKE_BUILD_TYPE=Release for meaningful numbers.");
+        AddExample("common_bench --filter thread_pool --json results.json");
+
+        AddOption('f', "filter", &Options.Filter)
+            .Help("Run only benchmarks whose name contains this string")
+            .Default("");
+        AddOption('r', "repetitions", &Options.Repetitions)
+            .Help("Measured runs of every benchmark")
+            .Default(Options.Repetitions);
+        AddOption('w', "warmup", &Options.WarmupRepetitions)
+            .Help("Unmeasured runs before the measured ones")
+            .Default(Options.WarmupRepetitions);
+        AddOption('t', "threads", &Options.ThreadCount)
+            .Help("Worker threads of the pools under test")
+            .Default(Options.ThreadCount);
+        AddOption('s', "scale", &Options.Scale)
+            .Help("Multiplier for the operation count of every benchmark")
+            .Default(Options.Scale);
+        AddOption('j', "json", &JsonPath)
+            .Help("Write the results as JSON to this file, or to stdout for \"-\"")
+            .Default("");
+    }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, const char* argv[]) {
+    TBenchmarkOpts opts;
+    try {
+        opts.Parse(argc, argv);
+    } catch (const std::exception& ex) {
+        std::cerr << ex.what() << std::endl;
+        return 1;
+    }
+    if (opts.IsVersionOrHelp()) {
+        return 0;
+    }
+
+    TBenchmarkRunner runner(opts.Options);
+    RegisterThreadPoolBenchmarks(runner);
+    RegisterAtomicIntrusivePtrBenchmarks(runner);
+    RegisterPeriodicExecutorBenchmarks(runner);
+    RegisterRefCountedBenchmarks(runner);
+
+    // Human-readable lines go to stderr when JSON takes stdout.
+    auto& out = opts.JsonPath == "-" ? std::cerr : std::cout;
+    auto results = runner.Run(out);
+
+    if (opts.JsonPath.empty()) {
+        return 0;
+    }
+    auto json = runner.ToJson(results).ToString(/*pretty*/ true);
+    if (opts.JsonPath == "-") {
+        std::cout << json << std::endl;
+        return 0;
+    }
+    std::ofstream file(opts.JsonPath);
+    if (!file) {
+        std::cerr << "Failed to open " << opts.JsonPath << std::endl;
+        return 1;
+    }
+    file << json << std::endl;
+    return 0;
+}
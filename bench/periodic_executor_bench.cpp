@@ -0,0 +1,97 @@
+#include <bench/harness.h>
+
+#include <common/latch.h>
+#include <common/periodic_executor.h>
+#include <common/threadpool.h>
+
+#include <memory>
+#include <vector>
+
+#include <sys/resource.h>
+
+namespace NBenchmark {
+
+using namespace NCommon;
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+constexpr size_t TimerCount = 10'000;
+constexpr std::chrono::milliseconds TimerPeriod{10};
+
+std::chrono::nanoseconds GetProcessCpuTime() {
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    auto toNanoseconds = [] (const timeval& time) {
+        return std::chrono::seconds(time.tv_sec) + std::chrono::microseconds(time.tv_usec);
+    };
+    return toNanoseconds(usage.ru_utime) + toNanoseconds(usage.ru_stime);
+}
+
+// Runs of one executor never overlap, so its samples need no lock.
+struct TTimerState {
+    TBenchmarkState::TClock::time_point Start;
+    uint64_t Ticks = 0;
+    std::vector<int64_t> Lateness;
+};
+
+// TimerCount fixed-rate executors tick until the operation count is spent.
+// Ops/sec is bounded by TimerCount / TimerPeriod when the executor keeps up;
+// lateness behind the nominal tick and CPU time per tick show the overhead.
+void PeriodicTimers(TBenchmarkState& state) {
+    auto pool = New<TThreadPool>(state.GetThreadCount());
+    auto invoker = New<TInvoker>(pool);
+    const uint64_t ticksPerTimer = std::max<uint64_t>(state.GetOperationCount() / TimerCount, 1);
+    TCountDownLatch done(ticksPerTimer * TimerCount);
+
+    std::vector<TTimerState> timers(TimerCount);
+    std::vector<TPeriodicExecutorPtr> executors;
+    executors.reserve(TimerCount);
+    for (auto& timer : timers) {
+        timer.Lateness.reserve(ticksPerTimer);
+        TPeriodicExecutorOptions options;
+        options.Period = TimerPeriod;
+        options.Mode = EPeriodicMode::FixedRate;
+        executors.push_back(New<TPeriodicExecutor>([&timer, &done, ticksPerTimer] {
+            // Without splay the first tick is due at Start and tick k at
+            // Start + k * Period. Skipped ticks count as lateness of the
+            // following ones rather than wrapping around.
+            auto sinceStart = TBenchmarkState::TClock::now() - timer.Start;
+            auto lateness = sinceStart - timer.Ticks * TimerPeriod;
+            timer.Lateness.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(lateness).count());
+            done.CountDown();
+            return ++timer.Ticks == ticksPerTimer;
+        }, invoker, options));
+    }
+
+    auto cpuTime = GetProcessCpuTime();
+    state.StartTimer();
+    for (size_t index = 0; index < TimerCount; ++index) {
+        timers[index].Start = TBenchmarkState::TClock::now();
+        executors[index]->Start();
+    }
+    done.Wait();
+    state.StopTimer();
+    cpuTime = GetProcessCpuTime() - cpuTime;
+
+    executors.clear();
+    for (const auto& timer : timers) {
+        for (auto lateness : timer.Lateness) {
+            state.RecordLatency(std::chrono::nanoseconds(lateness));
+        }
+    }
+    state.SetCounter("cpu_ns_per_tick", static_cast<double>(cpuTime.count()) / (ticksPerTimer * TimerCount));
+}
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////
+
+void RegisterPeriodicExecutorBenchmarks(TBenchmarkRunner& runner) {
+    runner.Register("periodic_executor/10k_timers", 20 * TimerCount, PeriodicTimers);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NBenchmark
@@ -0,0 +1,118 @@
+#include <bench/harness.h>
+
+#include <common/arena.h>
+#include <common/intrusive_ptr.h>
+
+#include <thread>
+#include <vector>
+
+namespace NBenchmark {
+
+using namespace NCommon;
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+// Sized like a small state object: a few pointers and counters.
+struct TPlainObject
+    : public NRefCounted::TRefCountedBase
+{
+    uint64_t Payload[6] = {};
+};
+
+struct TPooledObject
+    : public NRefCounted::TRefCountedBase
+{
+    uint64_t Payload[6] = {};
+};
+
+DECLARE_POOLED_REFCOUNTED(TPooledObject);
+
+// Objects are kept alive in windows of this size, so allocation and freeing
+// interleave the way they do for in-flight futures.
+constexpr size_t LiveWindow = 256;
+
+template <typename T>
+void NewAndRelease(TBenchmarkState& state) {
+    std::vector<TIntrusivePtr<T>> live(LiveWindow);
+    state.StartTimer();
+    for (uint64_t index = 0; index < state.GetOperationCount(); ++index) {
+        live[index % LiveWindow] = New<T>();
+    }
+    state.StopTimer();
+}
+
+// Objects are created on one thread and released on another, which is the
+// common case for promises resolved by a worker.
+template <typename T>
+void CrossThreadRelease(TBenchmarkState& state) {
+    std::vector<TIntrusivePtr<T>> objects;
+    objects.reserve(state.GetOperationCount());
+
+    state.StartTimer();
+    for (uint64_t index = 0; index < state.GetOperationCount(); ++index) {
+        objects.push_back(New<T>());
+    }
+    std::thread releaser([&objects] {
+        objects.clear();
+    });
+    releaser.join();
+    state.StopTimer();
+}
+
+// Every window is one request: its objects come from a fresh arena that is
+// released in bulk when the last of them dies.
+void NewInArena(TBenchmarkState& state) {
+    std::vector<TPooledObjectPtr> live;
+    live.reserve(LiveWindow);
+    size_t reservedBytes = 0;
+    state.StartTimer();
+    for (uint64_t index = 0; index < state.GetOperationCount(); index += LiveWindow) {
+        live.clear();
+        auto arena = New<TArena>();
+        TArenaScope scope(arena);
+        for (uint64_t offset = 0; offset < LiveWindow && index + offset < state.GetOperationCount(); ++offset) {
+            live.push_back(New<TPooledObject>());
+        }
+        reservedBytes = arena->GetReservedBytes();
+    }
+    live.clear();
+    state.StopTimer();
+    state.SetCounter("arena_reserved_kib", reservedBytes / 1024.0);
+}
+
+void ReportPoolStatistics(TBenchmarkState& state) {
+    auto statistics = NRefCounted::GetPoolStatistics();
+    uint64_t allocations = 0;
+    size_t usedBlocks = 0;
+    for (const auto& sizeClass : statistics.SizeClasses) {
+        allocations += sizeClass.Allocations;
+        usedBlocks += sizeClass.GetUsedBlocks();
+    }
+    state.SetCounter("pool_allocations", allocations);
+    state.SetCounter("pool_used_blocks", usedBlocks);
+    state.SetCounter("pool_slab_kib", statistics.SlabBytes / 1024.0);
+}
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////
+
+void RegisterRefCountedBenchmarks(TBenchmarkRunner& runner) {
+    runner.Register("refcounted/new/malloc", 10'000'000, NewAndRelease<TPlainObject>);
+    runner.Register("refcounted/new/pooled", 10'000'000, [] (TBenchmarkState& state) {
+        NewAndRelease<TPooledObject>(state);
+        ReportPoolStatistics(state);
+    });
+    runner.Register("refcounted/new/arena", 10'000'000, NewInArena);
+    runner.Register("refcounted/cross_thread/malloc", 1'000'000, CrossThreadRelease<TPlainObject>);
+    runner.Register("refcounted/cross_thread/pooled", 1'000'000, [] (TBenchmarkState& state) {
+        CrossThreadRelease<TPooledObject>(state);
+        ReportPoolStatistics(state);
+    });
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NBenchmark
@@ -0,0 +1,125 @@
+#include <bench/harness.h>
+
+#include <common/future.h>
+#include <common/latch.h>
+#include <common/threadpool.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace NBenchmark {
+
+using namespace NCommon;
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+// Tasks of a fan-out round joined by a single AllOf.
+constexpr uint64_t FanOutWidth = 1000;
+
+void EmptyTasks(TBenchmarkState& state, TThreadPoolOptions options) {
+    auto pool = New<TThreadPool>(state.GetThreadCount(), options);
+    auto invoker = New<TInvoker>(pool);
+    TCountDownLatch done(state.GetOperationCount());
+
+    state.StartTimer();
+    for (uint64_t index = 0; index < state.GetOperationCount(); ++index) {
+        invoker->Invoke([&done] {
+            done.CountDown();
+        });
+    }
+    done.Wait();
+    state.StopTimer();
+}
+
+void FanOutFanIn(TBenchmarkState& state) {
+    auto pool = New<TThreadPool>(state.GetThreadCount());
+    auto invoker = New<TInvoker>(pool);
+
+    state.StartTimer();
+    for (uint64_t submitted = 0; submitted < state.GetOperationCount(); ) {
+        const auto width = std::min(FanOutWidth, state.GetOperationCount() - submitted);
+        std::vector<TFuture<uint64_t>> futures;
+        futures.reserve(width);
+        for (uint64_t index = 0; index < width; ++index) {
+            futures.push_back(invoker->Run([value = submitted + index] {
+                return value * value;
+            }));
+        }
+        AllOf(std::move(futures)).Get().ThrowOnError();
+        submitted += width;
+    }
+    state.StopTimer();
+}
+
+void ProducerContention(TBenchmarkState& state) {
+    auto pool = New<TThreadPool>(state.GetThreadCount());
+    auto invoker = New<TInvoker>(pool);
+    // At least as many producers as workers, so the queue is contended even
+    // on small machines.
+    const size_t producerCount = std::max<size_t>(state.GetThreadCount(), 4);
+    TCountDownLatch done(state.GetOperationCount());
+    std::atomic<bool> go{false};
+
+    std::vector<std::thread> producers;
+    for (size_t producer = 0; producer < producerCount; ++producer) {
+        const uint64_t count = state.GetOperationCount() / producerCount +
+            (producer < state.GetOperationCount() % producerCount ? 1 : 0);
+        producers.emplace_back([&, count] {
+            while (!go.load(std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
+            for (uint64_t index = 0; index < count; ++index) {
+                invoker->Invoke([&done] {
+                    done.CountDown();
+                });
+            }
+        });
+    }
+
+    state.StartTimer();
+    go.store(true, std::memory_order_release);
+    done.Wait();
+    state.StopTimer();
+
+    for (auto& producer : producers) {
+        producer.join();
+    }
+}
+
+void PingPong(TBenchmarkState& state) {
+    auto pool = New<TThreadPool>(1);
+    auto invoker = New<TInvoker>(pool);
+
+    state.StartTimer();
+    for (uint64_t index = 0; index < state.GetOperationCount(); ++index) {
+        auto start = TBenchmarkState::TClock::now();
+        invoker->Run([] { }).Get();
+        state.RecordLatency(TBenchmarkState::TClock::now() - start);
+    }
+    state.StopTimer();
+}
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////
+
+void RegisterThreadPoolBenchmarks(TBenchmarkRunner& runner) {
+    runner.Register("thread_pool/empty_task/mutex", 1'000'000, [] (TBenchmarkState& state) {
+        EmptyTasks(state, {});
+    });
+    runner.Register("thread_pool/empty_task/lock_free", 1'000'000, [] (TBenchmarkState& state) {
+        TThreadPoolOptions options;
+        options.Backend = EQueueBackend::LockFree;
+        EmptyTasks(state, options);
+    });
+    runner.Register("invoker/fan_out_fan_in", 200'000, FanOutFanIn);
+    runner.Register("thread_pool/producer_contention", 1'000'000, ProducerContention);
+    runner.Register("invoker/ping_pong", 50'000, PingPong);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NBenchmark
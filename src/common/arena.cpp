@@ -0,0 +1,166 @@
+#include <common/arena.h>
+#include <common/exception.h>
+
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <utility>
+
+namespace NCommon {
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+thread_local TArena* CurrentArena = nullptr;
+
+// One released chunk kept per thread, so a request that fits into a chunk
+// does not go to the system allocator at all.
+class TSpareChunk {
+public:
+    ~TSpareChunk() {
+        std::free(Chunk_);
+    }
+
+    void* Take() {
+        return std::exchange(Chunk_, nullptr);
+    }
+
+    // Returns false if a chunk is kept already.
+    bool Put(void* chunk) {
+        if (Chunk_) {
+            return false;
+        }
+        Chunk_ = chunk;
+        return true;
+    }
+
+private:
+    void* Chunk_ = nullptr;
+};
+
+thread_local TSpareChunk SpareChunk;
+
+} // namespace
+
+struct TArena::TChunk {
+    TArena* Arena;
+    TChunk* Next;
+};
+
+TArena::~TArena() {
+    while (Chunks_) {
+        auto* next = Chunks_->Next;
+        if (!SpareChunk.Put(Chunks_)) {
+            std::free(Chunks_);
+        }
+        Chunks_ = next;
+    }
+}
+
+size_t TArena::GetAllocatedBytes() const {
+    return AllocatedBytes_;
+}
+
+size_t TArena::GetReservedBytes() const {
+    return ChunkCount_ * ChunkSize;
+}
+
+void* TArena::Allocate(size_t size, size_t alignment) {
+    constexpr size_t ChunkHeaderSize = (sizeof(TChunk) + alignof(std::max_align_t) - 1)
+        / alignof(std::max_align_t) * alignof(std::max_align_t);
+    if (size + alignment > ChunkSize - ChunkHeaderSize) {
+        return nullptr;
+    }
+
+    auto align = [alignment] (char* ptr) {
+        auto address = reinterpret_cast<uintptr_t>(ptr);
+        return reinterpret_cast<char*>((address + alignment - 1) & ~(alignment - 1));
+    };
+
+    char* block = Current_ ? align(Current_) : nullptr;
+    if (!block || block + size > End_) {
+        auto* chunk = static_cast<TChunk*>(SpareChunk.Take());
+        if (!chunk) {
+            chunk = static_cast<TChunk*>(std::aligned_alloc(ChunkSize, ChunkSize));
+        }
+        if (!chunk) {
+            throw std::bad_alloc();
+        }
+        chunk->Arena = this;
+        chunk->Next = Chunks_;
+        Chunks_ = chunk;
+        ++ChunkCount_;
+
+        End_ = reinterpret_cast<char*>(chunk) + ChunkSize;
+        block = align(reinterpret_cast<char*>(chunk) + ChunkHeaderSize);
+    }
+
+    AllocatedBytes_ += size;
+    Current_ = block + size;
+    return block;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+TArenaScope::TArenaScope(TArenaPtr arena)
+    : Arena_(std::move(arena))
+    , Previous_(CurrentArena)
+{
+    auto self = std::this_thread::get_id();
+    auto owner = std::thread::id();
+    if (!Arena_->Owner_.compare_exchange_strong(owner, self, std::memory_order_acquire)) {
+        ASSERT(owner == self, "Arena is current on another thread");
+    }
+    ++Arena_->ScopeDepth_;
+    CurrentArena = Arena_.Get();
+}
+
+TArenaScope::~TArenaScope() {
+    CurrentArena = Previous_;
+    if (--Arena_->ScopeDepth_ == 0) {
+        // The scope's own reference keeps the count above zero.
+        if (Arena_->ReservedRefs_ > 0) {
+            NRefCounted::Unref(Arena_.Get(), Arena_->ReservedRefs_);
+            Arena_->ReservedRefs_ = 0;
+        }
+        Arena_->Owner_.store(std::thread::id(), std::memory_order_release);
+    }
+}
+
+TArena* GetCurrentArena() {
+    return CurrentArena;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NCommon
+
+namespace NRefCounted {
+
+////////////////////////////////////////////////////////////////////////////////
+
+void* AllocateFromCurrentArena(size_t size, size_t alignment) {
+    auto* arena = NCommon::CurrentArena;
+    if (!arena) {
+        return nullptr;
+    }
+    void* block = arena->Allocate(size, alignment);
+    if (block) {
+        if (arena->ReservedRefs_ == 0) {
+            Ref(arena, NCommon::TArena::RefReservation);
+            arena->ReservedRefs_ = NCommon::TArena::RefReservation;
+        }
+        --arena->ReservedRefs_;
+    }
+    return block;
+}
+
+void FreeToArena(void* ptr) noexcept {
+    auto address = reinterpret_cast<uintptr_t>(ptr) & ~(NCommon::TArena::ChunkSize - 1);
+    Unref(reinterpret_cast<NCommon::TArena::TChunk*>(address)->Arena);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NRefCounted
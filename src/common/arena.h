@@ -0,0 +1,94 @@
+#pragma once
+
+#include <common/intrusive_ptr.h>
+
+#include <atomic>
+#include <cstddef>
+#include <thread>
+
+namespace NCommon {
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Bump allocator for request-scoped object graphs. While a TArenaScope makes
+// an arena current, New<T> of pooled types (DECLARE_POOLED_REFCOUNTED) carves
+// the ref counter and object from the arena instead of the pools. Freeing
+// such an object only drops the reference it holds on the arena; the memory
+// is released in bulk when the arena and all its objects are gone.
+//
+// Objects that do not fit into a chunk fall back to the usual allocation, and
+// so do types declared with DECLARE_POOLED_LONG_LIVED_REFCOUNTED.
+class TArena
+    : public NRefCounted::TRefCountedBase
+{
+public:
+    // Chunks are aligned to their size, so a block finds its arena by
+    // masking its address.
+    static constexpr size_t ChunkSize = 64 * 1024;
+
+    TArena() = default;
+    ~TArena();
+
+    // Bytes handed out to objects.
+    size_t GetAllocatedBytes() const;
+
+    // Bytes of the chunks held.
+    size_t GetReservedBytes() const;
+
+private:
+    friend class TArenaScope;
+    friend void* NRefCounted::AllocateFromCurrentArena(size_t size, size_t alignment);
+    friend void NRefCounted::FreeToArena(void* ptr) noexcept;
+
+    struct TChunk;
+
+    TChunk* Chunks_ = nullptr;
+    char* Current_ = nullptr;
+    char* End_ = nullptr;
+    size_t AllocatedBytes_ = 0;
+    size_t ChunkCount_ = 0;
+
+    // Allocation is not synchronized: the arena may be current on one thread
+    // at a time. Scopes of the owning thread nest.
+    std::atomic<std::thread::id> Owner_;
+    size_t ScopeDepth_ = 0;
+
+    // Every object holds a reference to the arena. The owning thread takes
+    // them from the counter in batches and gives back the rest when its
+    // outermost scope ends, so only releasing an object is an atomic write.
+    static constexpr int RefReservation = 1024;
+    int ReservedRefs_ = 0;
+
+    // Returns null if the block does not fit into a chunk.
+    void* Allocate(size_t size, size_t alignment);
+};
+
+DECLARE_REFCOUNTED(TArena);
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Makes |arena| current on the calling thread until destroyed, restoring the
+// previous one. Holds a reference, so the arena outlives the scope.
+//
+// Any object placed in the arena keeps all of its chunks alive. Objects that
+// outlive the request, such as a cache entry created inside the scope, should
+// be created outside of it.
+class TArenaScope {
+public:
+    explicit TArenaScope(TArenaPtr arena);
+    ~TArenaScope();
+
+    TArenaScope(const TArenaScope&) = delete;
+    TArenaScope& operator=(const TArenaScope&) = delete;
+
+private:
+    TArenaPtr Arena_;
+    TArena* Previous_;
+};
+
+// Null outside of any TArenaScope.
+TArena* GetCurrentArena();
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NCommon
@@ -1 +1,164 @@
 #include <common/atomic_intrusive_ptr.h>
+
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
+namespace NCommon {
+
+namespace NDetails {
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+// Every record ever created; pushed at the head and never unlinked, so
+// scanners may walk it without synchronizing with new threads.
+std::atomic<THazardRecord*> RecordList = nullptr;
+
+// Records the thread has taken and currently does not use. On thread exit
+// they are marked inactive for other threads to pick up.
+class THazardRecordCache {
+public:
+    ~THazardRecordCache() {
+        for (auto* record : Records_) {
+            record->Active.store(false, std::memory_order_release);
+        }
+    }
+
+    THazardRecord* Pop() {
+        if (Records_.empty()) {
+            return nullptr;
+        }
+        auto* record = Records_.back();
+        Records_.pop_back();
+        return record;
+    }
+
+    void Push(THazardRecord* record) {
+        Records_.push_back(record);
+    }
+
+private:
+    std::vector<THazardRecord*> Records_;
+};
+
+thread_local THazardRecordCache RecordCache;
+
+struct TRetiredPointer {
+    void* Pointer;
+    void (*Reclaim)(void*);
+};
+
+// Writers are rare next to readers, so retirement is serialized.
+struct TRetiredList {
+    std::mutex Mutex;
+    std::vector<TRetiredPointer> Pointers;
+};
+
+TRetiredList& GetRetiredList() {
+    // Leaked: holders with static storage duration retire on destruction.
+    static auto* list = new TRetiredList();
+    return *list;
+}
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////
+
+THazardRecord* AcquireHazardRecord() {
+    if (auto* record = RecordCache.Pop()) {
+        return record;
+    }
+
+    for (auto* record = RecordList.load(std::memory_order_acquire); record; record = record->Next) {
+        bool active = false;
+        if (!record->Active.load(std::memory_order_relaxed) &&
+            record->Active.compare_exchange_strong(active, true, std::memory_order_acquire))
+        {
+            return record;
+        }
+    }
+
+    auto* record = new THazardRecord();
+    record->Active.store(true, std::memory_order_relaxed);
+    auto* head = RecordList.load(std::memory_order_relaxed);
+    do {
+        record->Next = head;
+    } while (!RecordList.compare_exchange_weak(head, record, std::memory_order_release, std::memory_order_relaxed));
+    return record;
+}
+
+namespace {
+
+// Reclaims the retired pointers no record holds any more; the records still
+// holding one are flagged to rescan once released.
+void ScanRetired(TRetiredPointer* retiring) {
+    std::vector<TRetiredPointer> reclaimable;
+    {
+        auto& retired = GetRetiredList();
+        std::lock_guard<std::mutex> lock(retired.Mutex);
+        if (retiring) {
+            retired.Pointers.push_back(*retiring);
+        }
+        if (retired.Pointers.empty()) {
+            return;
+        }
+
+        // Sequentially consistent loads pair with the readers' publish and
+        // recheck: a reader either shows up here or sees the new value.
+        std::vector<std::pair<void*, THazardRecord*>> hazards;
+        for (auto* record = RecordList.load(std::memory_order_acquire); record; record = record->Next) {
+            if (auto* hazard = record->Pointer.load()) {
+                hazards.emplace_back(hazard, record);
+            }
+        }
+        std::sort(hazards.begin(), hazards.end());
+
+        auto findHazards = [&] (void* pointer) {
+            return std::equal_range(hazards.begin(), hazards.end(), std::pair<void*, THazardRecord*>(pointer, nullptr),
+                [] (const auto& lhs, const auto& rhs) {
+                    return lhs.first < rhs.first;
+                });
+        };
+        auto protectedEnd = std::partition(retired.Pointers.begin(), retired.Pointers.end(), [&] (const TRetiredPointer& entry) {
+            auto [begin, end] = findHazards(entry.Pointer);
+            for (auto it = begin; it != end; ++it) {
+                it->second->RescanOnRelease.store(true, std::memory_order_relaxed);
+            }
+            return begin != end;
+        });
+        reclaimable.assign(protectedEnd, retired.Pointers.end());
+        retired.Pointers.erase(protectedEnd, retired.Pointers.end());
+    }
+
+    // Outside the lock: destructors may retire values of their own holders.
+    for (const auto& entry : reclaimable) {
+        entry.Reclaim(entry.Pointer);
+    }
+}
+
+} // namespace
+
+void ReleaseHazardRecord(THazardRecord* record) {
+    record->Pointer.store(nullptr, std::memory_order_release);
+    // A flag set concurrently with the store above may be missed; the
+    // pointer is then reclaimed on the next rescan or retirement.
+    if (record->RescanOnRelease.load(std::memory_order_relaxed) &&
+        record->RescanOnRelease.exchange(false, std::memory_order_relaxed))
+    {
+        ScanRetired(nullptr);
+    }
+    RecordCache.Push(record);
+}
+
+void RetireHazardPointer(void* pointer, void (*reclaim)(void*)) {
+    TRetiredPointer retiring{pointer, reclaim};
+    ScanRetired(&retiring);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NDetails
+
+} // namespace NCommon
@@ -1,41 +1,211 @@
 #pragma once
 
 #include <common/intrusive_ptr.h>
-#include <mutex>
+
+#include <atomic>
 
 namespace NCommon {
 
 ////////////////////////////////////////////////////////////////////////////////
 
+namespace NDetails {
+
+// Hazard pointer: while Pointer names an object, retiring that object is
+// deferred. A record is owned by one thread at a time and sits on its own
+// cache line, so publishing into it touches no line other threads write.
+struct alignas(64) THazardRecord {
+    std::atomic<void*> Pointer = nullptr;
+    std::atomic<bool> Active = false;
+    // Set when Pointer held back a retirement: releasing the record then
+    // looks at the retired pointers again.
+    std::atomic<bool> RescanOnRelease = false;
+    THazardRecord* Next = nullptr;
+};
+
+// Takes a record for the calling thread; records are cached per thread and
+// never freed, so the fast path is a thread-local pop.
+THazardRecord* AcquireHazardRecord();
+
+// Clears the record and returns it to the calling thread's cache.
+void ReleaseHazardRecord(THazardRecord* record);
+
+// Calls |reclaim| on |pointer| once no hazard record holds it. Pointers still
+// protected at the time are kept and rechecked when the records protecting
+// them are released, and on later retirements.
+void RetireHazardPointer(void* pointer, void (*reclaim)(void*));
+
+} // namespace NDetails
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Intrusive pointer that can be read and replaced concurrently. The holder owns
+// one strong reference to its value. Readers protect the value with a hazard
+// pointer instead of a lock, so reads never contend with each other; a
+// replaced value drops the holder's reference only once no reader can still
+// be about to take one.
 template <typename T>
 class TAtomicIntrusivePtr {
 public:
+    // Borrowed view of the value at the time of Read(). It stays alive while
+    // the guard exists even if the holder is updated meanwhile. Taking and
+    // dropping a guard writes only the calling thread's hazard record, not
+    // the object's reference count.
+    class TReadGuard {
+    public:
+        TReadGuard(TReadGuard&& other) noexcept
+            : Record_(other.Record_)
+            , Ptr_(other.Ptr_)
+        {
+            other.Record_ = nullptr;
+            other.Ptr_ = nullptr;
+        }
+
+        TReadGuard(const TReadGuard&) = delete;
+        TReadGuard& operator=(const TReadGuard&) = delete;
+        TReadGuard& operator=(TReadGuard&&) = delete;
+
+        ~TReadGuard() {
+            if (Record_) {
+                NDetails::ReleaseHazardRecord(Record_);
+            }
+        }
+
+        T* Get() const {
+            return Ptr_;
+        }
+
+        T& operator*() const {
+            return *Ptr_;
+        }
+
+        T* operator->() const {
+            return Ptr_;
+        }
+
+        explicit operator bool() const {
+            return Ptr_;
+        }
+
+    private:
+        friend class TAtomicIntrusivePtr;
+
+        TReadGuard(NDetails::THazardRecord* record, T* ptr)
+            : Record_(record)
+            , Ptr_(ptr)
+        { }
+
+        NDetails::THazardRecord* Record_;
+        T* Ptr_;
+    };
+
     TAtomicIntrusivePtr() = default;
 
-    explicit TAtomicIntrusivePtr(const TIntrusivePtr<T>& ptr) : ptr_(ptr) {}
+    explicit TAtomicIntrusivePtr(TIntrusivePtr<T> ptr)
+        : Ptr_(Adopt(std::move(ptr)))
+    { }
 
-    ~TAtomicIntrusivePtr() = default;
+    ~TAtomicIntrusivePtr() {
+        Retire(Ptr_.load(std::memory_order_relaxed));
+    }
 
     TAtomicIntrusivePtr(const TAtomicIntrusivePtr&) = delete;
     TAtomicIntrusivePtr& operator=(const TAtomicIntrusivePtr&) = delete;
     TAtomicIntrusivePtr(TAtomicIntrusivePtr&&) = delete;
     TAtomicIntrusivePtr& operator=(TAtomicIntrusivePtr&&) = delete;
 
+    // Returns a new strong reference to the current value. The only shared
+    // write is the reference count of the value itself; use Read() to avoid
+    // even that.
     TIntrusivePtr<T> Acquire() const {
-        std::lock_guard<std::mutex> lock(mutex_);
-        return ptr_;
+        auto* record = NDetails::AcquireHazardRecord();
+        TIntrusivePtr<T> result(Protect(record));
+        NDetails::ReleaseHazardRecord(record);
+        return result;
     }
 
-    TIntrusivePtr<T> Store(const TIntrusivePtr<T>& newPtr) {
-        std::lock_guard<std::mutex> lock(mutex_);
-        TIntrusivePtr<T> oldPtr = ptr_;
-        ptr_ = newPtr;
-        return oldPtr;
+    TReadGuard Read() const {
+        auto* record = NDetails::AcquireHazardRecord();
+        return TReadGuard(record, Protect(record));
+    }
+
+    void Store(TIntrusivePtr<T> newPtr) {
+        Retire(Ptr_.exchange(Adopt(std::move(newPtr))));
+    }
+
+    // Stores |newPtr| and returns the value it replaced.
+    TIntrusivePtr<T> Exchange(TIntrusivePtr<T> newPtr) {
+        T* oldPtr = Ptr_.exchange(Adopt(std::move(newPtr)));
+        // The holder's reference is still alive here: readers that protected
+        // oldPtr may yet take theirs, so it is retired rather than dropped.
+        TIntrusivePtr<T> result(oldPtr);
+        Retire(oldPtr);
+        return result;
+    }
+
+    // Stores |newPtr| if the current value is |expected| (compared by
+    // address). On failure |expected| is reloaded with the current value, so
+    // the call fits a read-modify-write retry loop.
+    bool CompareAndSwap(TIntrusivePtr<T>& expected, TIntrusivePtr<T> newPtr) {
+        T* expectedPtr = expected.Get();
+        T* desiredPtr = newPtr.Get();
+        if (!Ptr_.compare_exchange_strong(expectedPtr, desiredPtr)) {
+            expected = Acquire();
+            return false;
+        }
+        Adopt(std::move(newPtr));
+        Retire(expected.Get());
+        return true;
+    }
+
+    void Reset() {
+        Store(TIntrusivePtr<T>());
+    }
+
+    // Racy by nature; for logging and assertions.
+    T* Get() const {
+        return Ptr_.load(std::memory_order_acquire);
+    }
+
+    explicit operator bool() const {
+        return Get();
     }
 
 private:
-    TIntrusivePtr<T> ptr_;
-    mutable std::mutex mutex_;
+    std::atomic<T*> Ptr_ = nullptr;
+
+    // Publishes the current value in |record| and rechecks it, so the value
+    // returned cannot be reclaimed until the record is cleared.
+    T* Protect(NDetails::THazardRecord* record) const {
+        T* ptr = Ptr_.load(std::memory_order_acquire);
+        while (ptr) {
+            record->Pointer.store(ptr);
+            T* current = Ptr_.load();
+            if (current == ptr) {
+                break;
+            }
+            ptr = current;
+        }
+        return ptr;
+    }
+
+    // Moves the strong reference held by |ptr| into a raw pointer.
+    static T* Adopt(TIntrusivePtr<T> ptr) {
+        T* raw = ptr.Get();
+        if (raw) {
+            NRefCounted::Ref(raw);
+        }
+        return raw;
+    }
+
+    static void Retire(T* ptr) {
+        if (ptr) {
+            NDetails::RetireHazardPointer(ptr, &Reclaim);
+        }
+    }
+
+    static void Reclaim(void* ptr) {
+        NRefCounted::Unref(static_cast<T*>(ptr));
+    }
 };
 
 ////////////////////////////////////////////////////////////////////////////////
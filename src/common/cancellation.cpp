@@ -0,0 +1,112 @@
+#include <common/cancellation.h>
+
+#include <vector>
+
+namespace NCommon {
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool TCancellationState::IsCancelled() const {
+    return Cancelled_.load(std::memory_order_acquire);
+}
+
+bool TCancellationState::Cancel() {
+    std::vector<TTask> callbacks;
+    {
+        std::lock_guard<std::mutex> lock(Mutex_);
+        if (Cancelled_.exchange(true, std::memory_order_acq_rel)) {
+            return false;
+        }
+        callbacks.reserve(Callbacks_.size());
+        for (auto& [cookie, callback] : Callbacks_) {
+            callbacks.push_back(std::move(callback));
+        }
+        Callbacks_.clear();
+    }
+    for (auto& callback : callbacks) {
+        callback();
+    }
+    return true;
+}
+
+TCancellationState::TCookie TCancellationState::Subscribe(TTask callback) {
+    {
+        std::lock_guard<std::mutex> lock(Mutex_);
+        if (!Cancelled_.load(std::memory_order_relaxed)) {
+            auto cookie = NextCookie_++;
+            Callbacks_.emplace(cookie, std::move(callback));
+            return cookie;
+        }
+    }
+    callback();
+    return 0;
+}
+
+void TCancellationState::Unsubscribe(TCookie cookie) {
+    if (cookie == 0) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(Mutex_);
+    Callbacks_.erase(cookie);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+TCancellationToken::TCancellationToken(TCancellationStatePtr state)
+    : State_(std::move(state))
+{}
+
+bool TCancellationToken::CanBeCancelled() const {
+    return static_cast<bool>(State_);
+}
+
+bool TCancellationToken::IsCancelled() const {
+    return State_ && State_->IsCancelled();
+}
+
+void TCancellationToken::ThrowIfCancelled() const {
+    if (IsCancelled()) {
+        throw MakeCancelledError();
+    }
+}
+
+TCancellationToken::TCookie TCancellationToken::Subscribe(TTask callback) const {
+    if (!State_) {
+        return 0;
+    }
+    return State_->Subscribe(std::move(callback));
+}
+
+void TCancellationToken::Unsubscribe(TCookie cookie) const {
+    if (State_) {
+        State_->Unsubscribe(cookie);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+TCancellationSource::TCancellationSource()
+    : State_(New<TCancellationState>())
+{}
+
+TCancellationToken TCancellationSource::GetToken() const {
+    return TCancellationToken(State_);
+}
+
+bool TCancellationSource::Cancel() const {
+    return State_->Cancel();
+}
+
+bool TCancellationSource::IsCancelled() const {
+    return State_->IsCancelled();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+TException MakeCancelledError() {
+    return TException(EErrorCode::Cancelled, "Operation cancelled");
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NCommon
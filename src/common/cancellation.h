@@ -0,0 +1,95 @@
+#pragma once
+
+#include <common/exception.h>
+#include <common/intrusive_ptr.h>
+#include <common/refcounted.h>
+#include <common/task.h>
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+
+namespace NCommon {
+
+////////////////////////////////////////////////////////////////////////////////
+
+class TCancellationState
+    : public NRefCounted::TRefCountedBase
+{
+public:
+    using TCookie = uint64_t;
+
+    bool IsCancelled() const;
+
+    // Returns false if already cancelled.
+    bool Cancel();
+
+    // Runs |callback| in the cancelling thread, or right away (returning 0) if
+    // already cancelled.
+    TCookie Subscribe(TTask callback);
+
+    void Unsubscribe(TCookie cookie);
+
+private:
+    std::atomic<bool> Cancelled_{false};
+    std::mutex Mutex_;
+    TCookie NextCookie_ = 1;
+    std::unordered_map<TCookie, TTask> Callbacks_;
+};
+
+DECLARE_REFCOUNTED(TCancellationState);
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Read side of a TCancellationSource. Cheap to copy; a default-constructed
+// token is never cancelled.
+class TCancellationToken {
+public:
+    using TCookie = TCancellationState::TCookie;
+
+    TCancellationToken() = default;
+
+    bool CanBeCancelled() const;
+
+    bool IsCancelled() const;
+
+    // For long tasks to poll: throws an EErrorCode::Cancelled error.
+    void ThrowIfCancelled() const;
+
+    TCookie Subscribe(TTask callback) const;
+
+    void Unsubscribe(TCookie cookie) const;
+
+private:
+    friend class TCancellationSource;
+
+    explicit TCancellationToken(TCancellationStatePtr state);
+
+    TCancellationStatePtr State_;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+class TCancellationSource {
+public:
+    TCancellationSource();
+
+    TCancellationToken GetToken() const;
+
+    // Returns false if already cancelled.
+    bool Cancel() const;
+
+    bool IsCancelled() const;
+
+private:
+    TCancellationStatePtr State_;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+TException MakeCancelledError();
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NCommon
@@ -1,4 +1,5 @@
 #include <common/config.h>
+#include <common/file_io.h>
 
 #include <fstream>
 #include <sstream>
@@ -26,6 +27,22 @@ void TConfigBase::LoadFromFile(const std::filesystem::path& filePath) {
     }
 }
 
+TFuture<void> TConfigBase::LoadFromFileAsync(const std::filesystem::path& filePath) {
+    const auto& service = TFileIOService::Get();
+    ASSERT(!service->GetInvoker()->GetThreadPool()->IsWorkerThread(),
+        "Config loading from file {} must not be started on the file I/O service's thread", filePath.string());
+
+    return service->ReadFile(filePath).Apply([this, filePath] (const TErrorOr<std::string>& content) {
+        try {
+            NJson::TJsonNode configJson = NJson::TJsonNode::Parse(content.ValueOrThrow());
+
+            this->Load(configJson);
+        } catch (const std::exception& e) {
+            RETHROW(e, "Config loading failed from file: {}", filePath.string());
+        }
+    });
+}
+
 void TConfigBase::Load(const NJson::TJsonNode& data) {
     if (RegisteredObjects_.empty()) {
         RegisterConfig();
@@ -3,6 +3,7 @@
 #include <common/refcounted.h>
 #include <common/intrusive_ptr.h>
 #include <common/exception.h>
+#include <common/future.h>
 #include <common/json.h>
 
 #include <filesystem>
@@ -18,8 +19,15 @@ namespace NCommon {
 class TConfigBase
 {
 public:
+    // Reads the file synchronously, so it is safe on any thread.
     void LoadFromFile(const std::filesystem::path& filePath);
 
+    // Never blocks on disk: the file is read asynchronously and parsed on the
+    // I/O service's invoker. Must not be called on that invoker, where
+    // waiting for the future would deadlock. The config is captured by
+    // reference and must outlive the future.
+    TFuture<void> LoadFromFileAsync(const std::filesystem::path& filePath);
+
     void Load(const NJson::TJsonNode& data);
 
     virtual void RegisterConfig() = 0;
@@ -0,0 +1,141 @@
+#include <common/coroutine.h>
+
+#include <array>
+#include <vector>
+
+namespace NCommon {
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+constexpr size_t FrameSizeClassStep = 64;
+constexpr size_t FrameSizeClassCount = 32;
+constexpr size_t MaxCachedFramesPerClass = 256;
+
+class TFrameCache {
+public:
+    ~TFrameCache();
+
+    std::array<std::vector<void*>, FrameSizeClassCount> FreeLists;
+};
+
+thread_local TFrameCache FrameCache;
+thread_local bool FrameCacheDestroyed = false;
+
+TFrameCache::~TFrameCache() {
+    FrameCacheDestroyed = true;
+    for (auto& list : FreeLists) {
+        for (void* ptr : list) {
+            ::operator delete(ptr);
+        }
+    }
+}
+
+size_t GetFrameSizeClass(size_t size) {
+    return (size + FrameSizeClassStep - 1) / FrameSizeClassStep;
+}
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace NDetails {
+
+void* AllocateCoroutineFrame(size_t size) {
+    size_t sizeClass = GetFrameSizeClass(size);
+    if (sizeClass > FrameSizeClassCount || FrameCacheDestroyed) {
+        return ::operator new(size);
+    }
+
+    auto& list = FrameCache.FreeLists[sizeClass - 1];
+    if (!list.empty()) {
+        void* ptr = list.back();
+        list.pop_back();
+        return ptr;
+    }
+    return ::operator new(sizeClass * FrameSizeClassStep);
+}
+
+void FreeCoroutineFrame(void* ptr, size_t size) noexcept {
+    size_t sizeClass = GetFrameSizeClass(size);
+    if (sizeClass > FrameSizeClassCount || FrameCacheDestroyed) {
+        ::operator delete(ptr);
+        return;
+    }
+
+    auto& list = FrameCache.FreeLists[sizeClass - 1];
+    if (list.size() >= MaxCachedFramesPerClass) {
+        ::operator delete(ptr);
+        return;
+    }
+    try {
+        list.push_back(ptr);
+    } catch (...) {
+        ::operator delete(ptr);
+    }
+}
+
+std::coroutine_handle<> TCoroutinePromiseBase::GetContinuation() noexcept {
+    if (!Continuation_) {
+        return std::noop_coroutine();
+    }
+
+    TInvoker* parentInvoker = ContinuationPromise_ ? ContinuationPromise_->GetInvoker().Get() : nullptr;
+    if (!parentInvoker || parentInvoker == Invoker_.Get()) {
+        return Continuation_;
+    }
+
+    auto invoker = ContinuationPromise_->GetInvoker();
+    invoker->Invoke([handle = Continuation_] {
+        handle.resume();
+    });
+    return std::noop_coroutine();
+}
+
+TSleepAwaiter TCoroutinePromiseBase::await_transform(TSleepAwaiter awaiter) {
+    awaiter.SetInvoker(Invoker_);
+    return awaiter;
+}
+
+} // namespace NDetails
+
+////////////////////////////////////////////////////////////////////////////////
+
+TSwitchToAwaiter SwitchTo(TIntrusivePtr<TInvoker> invoker) {
+    return TSwitchToAwaiter(std::move(invoker));
+}
+
+TSleepAwaiter::TSleepAwaiter(TDelayedExecutor::TClock::duration delay)
+    : Delay_(delay)
+{}
+
+void TSleepAwaiter::await_suspend(std::coroutine_handle<> handle) const {
+    TDelayedExecutor::Get().Submit([handle, invoker = Invoker_] {
+        if (invoker) {
+            invoker->Invoke([handle] {
+                handle.resume();
+            });
+        } else {
+            handle.resume();
+        }
+    }, Delay_);
+}
+
+void TSleepAwaiter::SetInvoker(TIntrusivePtr<TInvoker> invoker) {
+    Invoker_ = std::move(invoker);
+}
+
+TSleepAwaiter SleepFor(TDelayedExecutor::TClock::duration delay) {
+    return TSleepAwaiter(delay);
+}
+
+TCoroutine<void> RunPeriodically(std::function<bool()> callback, std::chrono::milliseconds delay) {
+    while (!callback()) {
+        co_await SleepFor(delay);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NCommon
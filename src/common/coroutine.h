@@ -0,0 +1,331 @@
+#pragma once
+
+#include <common/delayed_executor.h>
+#include <common/future.h>
+#include <common/threadpool.h>
+
+#include <chrono>
+#include <coroutine>
+#include <functional>
+#include <optional>
+#include <utility>
+
+namespace NCommon {
+
+////////////////////////////////////////////////////////////////////////////////
+
+template <typename T>
+class TCoroutine;
+
+class TSleepAwaiter;
+
+namespace NDetails {
+
+// Thread-local size-class free lists for coroutine frames.
+void* AllocateCoroutineFrame(size_t size);
+void FreeCoroutineFrame(void* ptr, size_t size) noexcept;
+
+////////////////////////////////////////////////////////////////////////////////
+
+class TCoroutinePromiseBase {
+public:
+    static void* operator new(size_t size) {
+        return AllocateCoroutineFrame(size);
+    }
+
+    static void operator delete(void* ptr, size_t size) noexcept {
+        FreeCoroutineFrame(ptr, size);
+    }
+
+    std::suspend_always initial_suspend() const noexcept {
+        return {};
+    }
+
+    TSwitchToAwaiter await_transform(TSwitchToAwaiter awaiter) {
+        Invoker_ = awaiter.GetInvoker();
+        return awaiter;
+    }
+
+    TSleepAwaiter await_transform(TSleepAwaiter awaiter);
+
+    template <typename T>
+    auto await_transform(TFuture<T> future);
+
+    template <typename TAwaitable>
+    TAwaitable&& await_transform(TAwaitable&& awaitable) {
+        return std::forward<TAwaitable>(awaitable);
+    }
+
+    const TIntrusivePtr<TInvoker>& GetInvoker() const {
+        return Invoker_;
+    }
+
+    void SetInvoker(TIntrusivePtr<TInvoker> invoker) {
+        Invoker_ = std::move(invoker);
+    }
+
+    void SetContinuation(std::coroutine_handle<> handle, TCoroutinePromiseBase* promise) {
+        Continuation_ = handle;
+        ContinuationPromise_ = promise;
+    }
+
+protected:
+    // Where to go once the frame has finished: back to the awaiting coroutine,
+    // directly if it lives on the same invoker and through its invoker
+    // otherwise.
+    std::coroutine_handle<> GetContinuation() noexcept;
+
+    TIntrusivePtr<TInvoker> Invoker_;
+    std::coroutine_handle<> Continuation_;
+    TCoroutinePromiseBase* ContinuationPromise_ = nullptr;
+};
+
+template <typename T>
+class TCoroutinePromise
+    : public TCoroutinePromiseBase
+{
+public:
+    template <typename U>
+    void return_value(U&& value) {
+        Result_.emplace(std::forward<U>(value));
+    }
+
+protected:
+    std::optional<TErrorOr<T>> Result_;
+};
+
+template <>
+class TCoroutinePromise<void>
+    : public TCoroutinePromiseBase
+{
+public:
+    void return_void() {
+        Result_.emplace();
+    }
+
+protected:
+    std::optional<TErrorOr<void>> Result_;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+template <typename T>
+class TFutureAwaiter {
+public:
+    TFutureAwaiter(TFuture<T> future, TIntrusivePtr<TInvoker> invoker)
+        : Future_(std::move(future))
+        , Invoker_(std::move(invoker))
+    {}
+
+    bool await_ready() const {
+        return Future_.IsSet();
+    }
+
+    void await_suspend(std::coroutine_handle<> handle) const {
+        // The callback may resume the coroutine and destroy this awaiter before
+        // Subscribe returns, so keep the future alive on the stack.
+        auto future = Future_;
+        future.Subscribe([handle, invoker = Invoker_] (const TErrorOr<T>& /*result*/) {
+            if (invoker) {
+                invoker->Invoke([handle] {
+                    handle.resume();
+                });
+            } else {
+                handle.resume();
+            }
+        });
+    }
+
+    // Awaiting a temporary future usually leaves the awaiter as the last
+    // holder of the result, which is then moved out.
+    TErrorOr<T> await_resume() {
+        return std::move(Future_).Extract();
+    }
+
+private:
+    TFuture<T> Future_;
+    TIntrusivePtr<TInvoker> Invoker_;
+};
+
+} // namespace NDetails
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Lazily started coroutine whose frame resumes on the invoker it was started
+// on (or switched to via SwitchTo/Yield). Awaiting a TFuture or another
+// TCoroutine yields TErrorOr<T>; the awaiting frame comes back on its own
+// invoker.
+template <typename T = void>
+class [[nodiscard]] TCoroutine {
+public:
+    class promise_type
+        : public NDetails::TCoroutinePromise<T>
+    {
+    public:
+        TCoroutine get_return_object() {
+            return TCoroutine(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+
+        void unhandled_exception() {
+            try {
+                throw;
+            } catch (const std::exception& ex) {
+                this->Result_.emplace(ex);
+            } catch (...) {
+                this->Result_.emplace(TException("Unknown exception in coroutine"));
+            }
+        }
+
+        auto final_suspend() noexcept {
+            struct TFinalAwaiter {
+                bool await_ready() const noexcept {
+                    return false;
+                }
+
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> handle) noexcept {
+                    return handle.promise().OnFinished(handle);
+                }
+
+                void await_resume() const noexcept
+                {}
+            };
+            return TFinalAwaiter{};
+        }
+
+        TErrorOr<T> ExtractResult() {
+            return std::move(*this->Result_);
+        }
+
+        void SetPromise(TPromise<T> promise) {
+            Promise_ = std::move(promise);
+        }
+
+    private:
+        std::coroutine_handle<> OnFinished(std::coroutine_handle<promise_type> handle) noexcept {
+            if (Promise_) {
+                // Detached by Start: nobody else owns the frame.
+                auto promise = std::move(Promise_);
+                auto result = ExtractResult();
+                handle.destroy();
+                promise.TrySet(std::move(result));
+                return std::noop_coroutine();
+            }
+            return this->GetContinuation();
+        }
+
+        TPromise<T> Promise_;
+    };
+
+    TCoroutine(TCoroutine&& other) noexcept
+        : Handle_(std::exchange(other.Handle_, {}))
+    {}
+
+    TCoroutine& operator=(TCoroutine&& other) noexcept {
+        if (this != &other) {
+            Reset();
+            Handle_ = std::exchange(other.Handle_, {});
+        }
+        return *this;
+    }
+
+    ~TCoroutine() {
+        Reset();
+    }
+
+    // Schedules the first resumption on |invoker| and hands the frame over to
+    // itself; the returned future is set when the body finishes.
+    TFuture<T> Start(TIntrusivePtr<TInvoker> invoker) && {
+        auto handle = std::exchange(Handle_, {});
+        auto promise = NewPromise<T>();
+        handle.promise().SetPromise(promise);
+        handle.promise().SetInvoker(invoker);
+        invoker->Invoke([handle] {
+            handle.resume();
+        });
+        return promise.ToFuture();
+    }
+
+    // Used when awaited from another coroutine.
+    bool await_ready() const noexcept {
+        return false;
+    }
+
+    template <typename TParentPromise>
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<TParentPromise> parent) noexcept {
+        auto& promise = Handle_.promise();
+        if constexpr (std::is_base_of_v<NDetails::TCoroutinePromiseBase, TParentPromise>) {
+            promise.SetInvoker(parent.promise().GetInvoker());
+            promise.SetContinuation(parent, &parent.promise());
+        } else {
+            promise.SetContinuation(parent, nullptr);
+        }
+        return Handle_;
+    }
+
+    TErrorOr<T> await_resume() {
+        return Handle_.promise().ExtractResult();
+    }
+
+private:
+    explicit TCoroutine(std::coroutine_handle<promise_type> handle)
+        : Handle_(handle)
+    {}
+
+    void Reset() {
+        if (Handle_) {
+            Handle_.destroy();
+            Handle_ = {};
+        }
+    }
+
+    std::coroutine_handle<promise_type> Handle_;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+// co_await SwitchTo(invoker) moves the rest of the coroutine onto |invoker|.
+TSwitchToAwaiter SwitchTo(TIntrusivePtr<TInvoker> invoker);
+
+// Suspends the coroutine without holding a pool thread and resumes it on its
+// current invoker after |delay|.
+class TSleepAwaiter {
+public:
+    explicit TSleepAwaiter(TDelayedExecutor::TClock::duration delay);
+
+    bool await_ready() const noexcept {
+        return false;
+    }
+
+    void await_suspend(std::coroutine_handle<> handle) const;
+
+    void await_resume() const noexcept
+    {}
+
+    void SetInvoker(TIntrusivePtr<TInvoker> invoker);
+
+private:
+    TDelayedExecutor::TClock::duration Delay_;
+    TIntrusivePtr<TInvoker> Invoker_;
+};
+
+TSleepAwaiter SleepFor(TDelayedExecutor::TClock::duration delay);
+
+// Coroutine counterpart of TPeriodicExecutor: calls |callback| on the
+// invoker the coroutine is started on, then sleeps |delay| without occupying a
+// worker, until the callback returns true.
+TCoroutine<void> RunPeriodically(std::function<bool()> callback, std::chrono::milliseconds delay);
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace NDetails {
+
+template <typename T>
+auto TCoroutinePromiseBase::await_transform(TFuture<T> future) {
+    return TFutureAwaiter<T>(std::move(future), Invoker_);
+}
+
+} // namespace NDetails
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NCommon
@@ -0,0 +1,163 @@
+#include <common/cpu_topology.h>
+#include <common/exception.h>
+
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+
+#include <pthread.h>
+#include <sched.h>
+
+namespace NCommon {
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+std::optional<std::string> ReadLine(const std::filesystem::path& path) {
+    std::ifstream file(path);
+    std::string line;
+    if (!file.is_open() || !std::getline(file, line)) {
+        return std::nullopt;
+    }
+    return line;
+}
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////
+
+TCpuTopology::TCpuTopology() {
+    if (auto online = ReadLine("/sys/devices/system/cpu/online")) {
+        Cpus_ = ParseCpuList(*online);
+    }
+    if (Cpus_.empty()) {
+        for (unsigned cpu = 0; cpu < std::max(1u, std::thread::hardware_concurrency()); ++cpu) {
+            Cpus_.push_back(cpu);
+        }
+    }
+
+    // Node directories may be sparse (node0, node2); keep only nodes that
+    // have online CPUs, in id order.
+    std::vector<std::pair<int, std::vector<int>>> nodes;
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator("/sys/devices/system/node", error)) {
+        auto name = entry.path().filename().string();
+        if (name.size() <= 4 || name.compare(0, 4, "node") != 0 ||
+            !std::all_of(name.begin() + 4, name.end(), [] (char c) { return std::isdigit(c); }))
+        {
+            continue;
+        }
+        auto list = ReadLine(entry.path() / "cpulist");
+        if (!list) {
+            continue;
+        }
+        std::vector<int> cpus;
+        for (int cpu : ParseCpuList(*list)) {
+            if (std::binary_search(Cpus_.begin(), Cpus_.end(), cpu)) {
+                cpus.push_back(cpu);
+            }
+        }
+        if (!cpus.empty()) {
+            nodes.emplace_back(std::stoi(name.substr(4)), std::move(cpus));
+        }
+    }
+    std::sort(nodes.begin(), nodes.end());
+
+    for (auto& [id, cpus] : nodes) {
+        NodeCpus_.push_back(std::move(cpus));
+    }
+    if (NodeCpus_.empty()) {
+        NodeCpus_.push_back(Cpus_);
+    }
+
+    CpuNodes_.assign(Cpus_.back() + 1, 0);
+    for (size_t node = 0; node < NodeCpus_.size(); ++node) {
+        for (int cpu : NodeCpus_[node]) {
+            CpuNodes_[cpu] = node;
+        }
+    }
+}
+
+const TCpuTopology& TCpuTopology::Get() {
+    static const TCpuTopology topology;
+    return topology;
+}
+
+const std::vector<int>& TCpuTopology::GetCpus() const {
+    return Cpus_;
+}
+
+size_t TCpuTopology::GetNodeCount() const {
+    return NodeCpus_.size();
+}
+
+const std::vector<int>& TCpuTopology::GetNodeCpus(size_t node) const {
+    return NodeCpus_.at(node);
+}
+
+size_t TCpuTopology::GetNodeOf(int cpu) const {
+    if (cpu < 0 || static_cast<size_t>(cpu) >= CpuNodes_.size()) {
+        return 0;
+    }
+    return CpuNodes_[cpu];
+}
+
+std::vector<int> TCpuTopology::ParseCpuList(const std::string& list) {
+    std::vector<int> cpus;
+    size_t position = 0;
+    while (position < list.size()) {
+        size_t end = list.find(',', position);
+        if (end == std::string::npos) {
+            end = list.size();
+        }
+        auto range = list.substr(position, end - position);
+        position = end + 1;
+
+        range.erase(std::remove_if(range.begin(), range.end(), [] (char c) { return std::isspace(c); }), range.end());
+        if (range.empty()) {
+            continue;
+        }
+        try {
+            size_t dash = range.find('-');
+            int first = std::stoi(range.substr(0, dash));
+            int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+            if (first < 0 || last < first) {
+                THROW("Invalid CPU range \"{}\"", range);
+            }
+            for (int cpu = first; cpu <= last; ++cpu) {
+                cpus.push_back(cpu);
+            }
+        } catch (const std::logic_error&) {
+            THROW("Invalid CPU range \"{}\"", range);
+        }
+    }
+    std::sort(cpus.begin(), cpus.end());
+    cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+    return cpus;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool SetCurrentThreadAffinity(const std::vector<int>& cpus) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus) {
+        if (cpu >= 0 && cpu < CPU_SETSIZE) {
+            CPU_SET(cpu, &set);
+        }
+    }
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+
+int GetCurrentCpu() {
+    return sched_getcpu();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NCommon
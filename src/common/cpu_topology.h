@@ -0,0 +1,46 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace NCommon {
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Online CPUs grouped by NUMA node, read once from /sys. Machines without NUMA
+// information look like a single node holding every online CPU.
+class TCpuTopology {
+public:
+    static const TCpuTopology& Get();
+
+    const std::vector<int>& GetCpus() const;
+
+    size_t GetNodeCount() const;
+
+    const std::vector<int>& GetNodeCpus(size_t node) const;
+
+    // Node of |cpu|, or 0 for an unknown CPU.
+    size_t GetNodeOf(int cpu) const;
+
+    // Parses the kernel list format, e.g. "0-3,8,10-11".
+    static std::vector<int> ParseCpuList(const std::string& list);
+
+private:
+    TCpuTopology();
+
+    std::vector<int> Cpus_;
+    std::vector<std::vector<int>> NodeCpus_;
+    std::vector<size_t> CpuNodes_;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Restricts the calling thread to |cpus|; returns false if the kernel refused.
+bool SetCurrentThreadAffinity(const std::vector<int>& cpus);
+
+// CPU the calling thread is running on, or -1 if unknown.
+int GetCurrentCpu();
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NCommon
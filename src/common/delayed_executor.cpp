@@ -0,0 +1,114 @@
+#include <common/delayed_executor.h>
+#include <common/logging.h>
+
+#include <vector>
+
+namespace NCommon {
+
+////////////////////////////////////////////////////////////////////////////////
+
+TDelayedExecutor::TDelayedExecutor()
+    : Start_(TClock::now())
+    , Thread_(&TDelayedExecutor::Worker, this)
+{}
+
+TDelayedExecutor::~TDelayedExecutor() {
+    {
+        std::lock_guard<std::mutex> lock(Mutex_);
+        Stop_ = true;
+    }
+    WakeUp_.notify_one();
+    Thread_.join();
+}
+
+TDelayedExecutor& TDelayedExecutor::Get() {
+    static TDelayedExecutor instance;
+    return instance;
+}
+
+TDelayedExecutor::TCookie TDelayedExecutor::Submit(TTask callback, TClock::time_point deadline) {
+    auto entry = New<TTimerEntry>(ToTick(deadline), std::move(callback));
+    bool earlier = false;
+    {
+        std::lock_guard<std::mutex> lock(Mutex_);
+        Wheel_.Insert(entry);
+        auto nextTick = Wheel_.GetNextTick();
+        if (nextTick && *nextTick < WakeUpTick_) {
+            WakeUpTick_ = *nextTick;
+            earlier = true;
+        }
+    }
+    if (earlier) {
+        WakeUp_.notify_one();
+    }
+    return entry;
+}
+
+TDelayedExecutor::TCookie TDelayedExecutor::Submit(TTask callback, TClock::duration delay) {
+    return Submit(std::move(callback), TClock::now() + delay);
+}
+
+void TDelayedExecutor::Cancel(const TCookie& cookie) {
+    if (!cookie) {
+        return;
+    }
+    // The entry stays in its slot until the wheel reaches it.
+    std::lock_guard<std::mutex> lock(Mutex_);
+    cookie->Cancel();
+}
+
+uint64_t TDelayedExecutor::ToTick(TClock::time_point time) const {
+    if (time <= Start_) {
+        return 0;
+    }
+    // Round up so that a callback never fires before its deadline.
+    auto elapsed = time - Start_;
+    return (elapsed + TickDuration - TClock::duration(1)) / TickDuration;
+}
+
+TDelayedExecutor::TClock::time_point TDelayedExecutor::ToTime(uint64_t tick) const {
+    return Start_ + tick * TickDuration;
+}
+
+void TDelayedExecutor::Worker() {
+    std::vector<TTimerEntryPtr> ready;
+    std::vector<TTask> callbacks;
+
+    std::unique_lock<std::mutex> lock(Mutex_);
+    while (!Stop_) {
+        auto now = TClock::now();
+        Wheel_.Advance((now - Start_) / TickDuration, &ready);
+
+        if (!ready.empty()) {
+            for (auto& entry : ready) {
+                callbacks.push_back(entry->ExtractCallback());
+            }
+            ready.clear();
+
+            lock.unlock();
+            for (auto& callback : callbacks) {
+                try {
+                    callback();
+                } catch (const std::exception& ex) {
+                    LOG_ERROR("Delayed callback failed: {}", ex.what());
+                }
+            }
+            callbacks.clear();
+            lock.lock();
+            continue;
+        }
+
+        auto nextTick = Wheel_.GetNextTick();
+        if (!nextTick) {
+            WakeUpTick_ = UINT64_MAX;
+            WakeUp_.wait(lock);
+        } else {
+            WakeUpTick_ = *nextTick;
+            WakeUp_.wait_until(lock, ToTime(*nextTick));
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NCommon
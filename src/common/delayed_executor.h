@@ -0,0 +1,56 @@
+#pragma once
+
+#include <common/task.h>
+#include <common/timer_wheel.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+namespace NCommon {
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Single background thread that fires callbacks at a given time, backed by a
+// millisecond-resolution TTimerWheel. Callbacks run on the timer thread and
+// must only hand work off (e.g. to a TInvoker).
+class TDelayedExecutor {
+public:
+    using TClock = std::chrono::steady_clock;
+    using TCookie = TTimerEntryPtr;
+
+    static constexpr std::chrono::milliseconds TickDuration{1};
+
+    static TDelayedExecutor& Get();
+
+    ~TDelayedExecutor();
+
+    TCookie Submit(TTask callback, TClock::time_point deadline);
+
+    TCookie Submit(TTask callback, TClock::duration delay);
+
+    // Drops the callback if it has not fired yet; null cookies are ignored.
+    void Cancel(const TCookie& cookie);
+
+private:
+    TDelayedExecutor();
+
+    uint64_t ToTick(TClock::time_point time) const;
+    TClock::time_point ToTime(uint64_t tick) const;
+
+    void Worker();
+
+    const TClock::time_point Start_;
+    TTimerWheel Wheel_;
+    uint64_t WakeUpTick_ = UINT64_MAX;
+    std::mutex Mutex_;
+    std::condition_variable WakeUp_;
+    bool Stop_ = false;
+    std::thread Thread_;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NCommon
@@ -0,0 +1,95 @@
+#include <common/event_count.h>
+
+#include <cerrno>
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace NCommon {
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+int FutexWait(uint32_t* address, uint32_t expected, const struct timespec* timeout) {
+    return syscall(SYS_futex, address, FUTEX_WAIT_PRIVATE, expected, timeout, nullptr, 0);
+}
+
+void FutexWake(uint32_t* address, int count) {
+    syscall(SYS_futex, address, FUTEX_WAKE_PRIVATE, count, nullptr, nullptr, 0);
+}
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////
+
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "the epoch must be the upper half of State_");
+
+TEventCount::TKey TEventCount::PrepareWait() {
+    // Seq-cst so that the caller's recheck cannot be ordered before it.
+    auto state = State_.fetch_add(1, std::memory_order_seq_cst);
+    return static_cast<TKey>(state >> EpochShift);
+}
+
+void TEventCount::CancelWait() {
+    State_.fetch_sub(1, std::memory_order_seq_cst);
+}
+
+void TEventCount::Wait(TKey key) {
+    while (static_cast<TKey>(State_.load(std::memory_order_acquire) >> EpochShift) == key) {
+        FutexWait(GetEpochAddress(), key, nullptr);
+    }
+    State_.fetch_sub(1, std::memory_order_seq_cst);
+}
+
+bool TEventCount::WaitFor(TKey key, std::chrono::nanoseconds timeout) {
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    bool notified = true;
+    while (static_cast<TKey>(State_.load(std::memory_order_acquire) >> EpochShift) == key) {
+        auto left = deadline - std::chrono::steady_clock::now();
+        if (left <= std::chrono::nanoseconds::zero()) {
+            notified = false;
+            break;
+        }
+        auto seconds = std::chrono::duration_cast<std::chrono::seconds>(left);
+        struct timespec spec;
+        spec.tv_sec = seconds.count();
+        spec.tv_nsec = std::chrono::duration_cast<std::chrono::nanoseconds>(left - seconds).count();
+        FutexWait(GetEpochAddress(), key, &spec);
+    }
+    State_.fetch_sub(1, std::memory_order_seq_cst);
+    return notified;
+}
+
+void TEventCount::NotifyOne() {
+    Notify(/*all*/ false);
+}
+
+void TEventCount::NotifyAll() {
+    Notify(/*all*/ true);
+}
+
+size_t TEventCount::GetWaiterCount() const {
+    return State_.load(std::memory_order_relaxed) & WaiterMask;
+}
+
+void TEventCount::Notify(bool all) {
+    // Pairs with PrepareWait: either the waiter's recheck sees what the caller
+    // published or the caller sees the waiter here.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if ((State_.load(std::memory_order_relaxed) & WaiterMask) == 0) {
+        return;
+    }
+    State_.fetch_add(uint64_t(1) << EpochShift, std::memory_order_seq_cst);
+    FutexWake(GetEpochAddress(), all ? INT32_MAX : 1);
+}
+
+uint32_t* TEventCount::GetEpochAddress() {
+    return reinterpret_cast<uint32_t*>(&State_) + 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NCommon
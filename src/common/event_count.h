@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace NCommon {
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Hint to the CPU that the caller is busy-waiting.
+inline void SpinLockPause() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Eventcount: lets threads wait for a condition that has no lock of its own.
+// A waiter announces itself with PrepareWait, rechecks the condition and then
+// either cancels or sleeps on a futex until the next notification. Notifiers
+// publish the condition first; when nobody is prepared to wait, Notify costs a
+// fence and a load and makes no system call.
+//
+//     auto key = eventCount.PrepareWait();
+//     if (condition()) {
+//         eventCount.CancelWait();
+//     } else {
+//         eventCount.Wait(key);
+//     }
+class TEventCount {
+public:
+    using TKey = uint32_t;
+
+    TKey PrepareWait();
+    void CancelWait();
+
+    void Wait(TKey key);
+    // Returns false on timeout; the wait is finished either way.
+    bool WaitFor(TKey key, std::chrono::nanoseconds timeout);
+
+    void NotifyOne();
+    void NotifyAll();
+
+    // Threads between PrepareWait and the end of their wait.
+    size_t GetWaiterCount() const;
+
+private:
+    void Notify(bool all);
+    uint32_t* GetEpochAddress();
+
+    static constexpr uint64_t WaiterMask = (uint64_t(1) << 32) - 1;
+    static constexpr int EpochShift = 32;
+
+    // Epoch in the upper half, waiter count in the lower half. The futex lives
+    // on the epoch.
+    std::atomic<uint64_t> State_{0};
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NCommon
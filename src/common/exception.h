@@ -10,11 +10,24 @@ namespace NCommon {
 
 ////////////////////////////////////////////////////////////////////////////////
 
+// Lets callers tell apart failures that TErrorOr stores by value.
+enum class EErrorCode {
+    Generic,
+    // Dropped through a TCancellationToken before it started.
+    Cancelled,
+    // Did not start before its deadline.
+    DeadlineExceeded,
+    // Shed by a full thread pool.
+    Overloaded,
+};
+
 class TException : public std::exception {
 public:
     explicit TException(const std::string& msg) : message(msg) {}
 
-    explicit TException(const std::exception& ex) : message(ex.what()) {}
+    TException(EErrorCode errorCode, const std::string& msg) : message(msg), code(errorCode) {}
+
+    explicit TException(const std::exception& ex) : message(ex.what()), code(GetCode(ex)) {}
 
     template<typename... Args>
     explicit TException(const std::string& format, Args&&... args)
@@ -27,7 +40,8 @@ public:
     
     template<typename... Args>
     TException(const std::exception& e, const std::string& format, Args&&... args)
-        : message(Format("{}: {}", Format(format, std::forward<Args>(args)...), e.what())) {}
+        : message(Format("{}: {}", Format(format, std::forward<Args>(args)...), e.what()))
+        , code(GetCode(e)) {}
     
     template<typename... Args>
     TException(const std::source_location& location, const std::exception& e, 
@@ -35,14 +49,26 @@ public:
         : message(Format("{}:{}: {}:\n{}", 
                          location.file_name(), location.line(),
                          Format(format, std::forward<Args>(args)...), 
-                         e.what())) {}
+                         e.what()))
+        , code(GetCode(e)) {}
 
     const char* what() const noexcept override {
         return message.c_str();
     }
 
+    EErrorCode GetCode() const {
+        return code;
+    }
+
 protected:
+    // Wrapping keeps the code of the original error.
+    static EErrorCode GetCode(const std::exception& ex) {
+        auto* exception = dynamic_cast<const TException*>(&ex);
+        return exception ? exception->code : EErrorCode::Generic;
+    }
+
     std::string message;
+    EErrorCode code = EErrorCode::Generic;
 };
 
 ////////////////////////////////////////////////////////////////////////////////
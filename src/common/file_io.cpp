@@ -0,0 +1,526 @@
+#include <common/exception.h>
+#include <common/file_io.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstring>
+
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace NCommon {
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+// Smallest read issued by ReadFile; also its step once the file turns out to
+// be larger than fstat said.
+constexpr size_t MinReadChunk = 64 * 1024;
+
+// user_data of the no-op that wakes up the completion thread on shutdown.
+constexpr uint64_t WakeupUserData = 0;
+
+unsigned AtomicLoad(const unsigned* value) {
+    return std::atomic_ref<const unsigned>(*value).load(std::memory_order_acquire);
+}
+
+void AtomicStore(unsigned* value, unsigned newValue) {
+    std::atomic_ref<unsigned>(*value).store(newValue, std::memory_order_release);
+}
+
+const char* GetOperationName(EFileIOOperation operation) {
+    switch (operation) {
+        case EFileIOOperation::Read:     return "Read";
+        case EFileIOOperation::Write:    return "Write";
+        case EFileIOOperation::Sync:     return "Sync";
+        case EFileIOOperation::DataSync: return "Data sync";
+    }
+    return "Operation";
+}
+
+int64_t RunBlocking(const TFileIORequest& request) {
+    while (true) {
+        int64_t result = -1;
+        switch (request.Operation) {
+            case EFileIOOperation::Read:
+                result = pread(request.Fd, request.Buffer, request.Size, request.Offset);
+                break;
+            case EFileIOOperation::Write:
+                result = pwrite(request.Fd, request.Buffer, request.Size, request.Offset);
+                break;
+            case EFileIOOperation::Sync:
+                result = fsync(request.Fd);
+                break;
+            case EFileIOOperation::DataSync:
+                result = fdatasync(request.Fd);
+                break;
+        }
+        if (result >= 0) {
+            return result;
+        }
+        if (errno != EINTR) {
+            return -errno;
+        }
+    }
+}
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Submission and completion rings shared with the kernel, driven with raw
+// system calls. Pushing and entering are serialized by the service; reaping
+// is done by the completion thread alone.
+class TFileIOService::TRing {
+public:
+    explicit TRing(unsigned entries) {
+        io_uring_params params{};
+        Fd_ = syscall(__NR_io_uring_setup, entries, &params);
+        if (Fd_ < 0) {
+            THROW("io_uring is not available: {}", std::strerror(errno));
+        }
+        if (!SupportsOperations()) {
+            Unmap();
+            THROW("io_uring does not support the file operations");
+        }
+
+        SqRingSize_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        CqRingSize_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        const bool singleMmap = params.features & IORING_FEAT_SINGLE_MMAP;
+        if (singleMmap) {
+            SqRingSize_ = CqRingSize_ = std::max(SqRingSize_, CqRingSize_);
+        }
+        SqesSize_ = params.sq_entries * sizeof(io_uring_sqe);
+
+        SqRing_ = Map(SqRingSize_, IORING_OFF_SQ_RING);
+        CqRing_ = singleMmap ? SqRing_ : Map(CqRingSize_, IORING_OFF_CQ_RING);
+        Sqes_ = static_cast<io_uring_sqe*>(Map(SqesSize_, IORING_OFF_SQES));
+
+        auto* sq = static_cast<char*>(SqRing_);
+        SqHead_ = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+        SqTail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        SqMask_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        SqArray_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        SqEntries_ = params.sq_entries;
+        LocalTail_ = *SqTail_;
+
+        auto* cq = static_cast<char*>(CqRing_);
+        CqHead_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        CqTail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        CqMask_ = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        Cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+        CqEntries_ = params.cq_entries;
+    }
+
+    ~TRing() {
+        Unmap();
+    }
+
+    // Operations in flight the completion ring always has room for; one
+    // entry is kept for the shutdown no-op.
+    size_t GetCapacity() const {
+        return std::min<size_t>(SqEntries_, CqEntries_ - 1);
+    }
+
+    // Returns false if the submission ring is full.
+    bool TryPush(const TFileIORequest& request, uint64_t userData) {
+        if (LocalTail_ - AtomicLoad(SqHead_) >= SqEntries_) {
+            return false;
+        }
+
+        const unsigned index = LocalTail_ & SqMask_;
+        auto& sqe = Sqes_[index];
+        std::memset(&sqe, 0, sizeof(sqe));
+        sqe.fd = request.Fd;
+        sqe.user_data = userData;
+        switch (request.Operation) {
+            case EFileIOOperation::Read:
+            case EFileIOOperation::Write:
+                sqe.opcode = request.Operation == EFileIOOperation::Read ? IORING_OP_READ : IORING_OP_WRITE;
+                sqe.addr = reinterpret_cast<uint64_t>(request.Buffer);
+                // Larger transfers just come out short.
+                sqe.len = std::min<size_t>(request.Size, INT_MAX);
+                sqe.off = request.Offset;
+                break;
+            case EFileIOOperation::Sync:
+                sqe.opcode = IORING_OP_FSYNC;
+                break;
+            case EFileIOOperation::DataSync:
+                sqe.opcode = IORING_OP_FSYNC;
+                sqe.fsync_flags = IORING_FSYNC_DATASYNC;
+                break;
+        }
+        SqArray_[index] = index;
+        AtomicStore(SqTail_, ++LocalTail_);
+        ++Unsubmitted_;
+        return true;
+    }
+
+    bool TryPushWakeup() {
+        TFileIORequest request;
+        request.Operation = EFileIOOperation::Sync;
+        if (!TryPush(request, WakeupUserData)) {
+            return false;
+        }
+        Sqes_[(LocalTail_ - 1) & SqMask_].opcode = IORING_OP_NOP;
+        return true;
+    }
+
+    // Hands pushed entries over to the kernel. Entries it cannot take for now
+    // (EAGAIN, EBUSY, ENOMEM) are left to the completion thread, which enters
+    // again after every wakeup; if nothing is in the kernel to wake it up,
+    // they are retried here.
+    void Enter() {
+        while (Unsubmitted_ > 0) {
+            long submitted = syscall(__NR_io_uring_enter, Fd_, Unsubmitted_, 0, 0, nullptr, 0);
+            if (submitted > 0) {
+                Unsubmitted_ -= submitted;
+                InKernel_.fetch_add(submitted, std::memory_order_relaxed);
+                continue;
+            }
+            if (submitted < 0 && errno == EINTR) {
+                continue;
+            }
+            // Anything else means the ring itself is broken.
+            VERIFY(submitted == 0 || errno == EAGAIN || errno == EBUSY || errno == ENOMEM);
+            if (InKernel_.load(std::memory_order_relaxed) > 0) {
+                return;
+            }
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+    }
+
+    // Blocks until the completion ring is not empty.
+    void Wait() {
+        long result = syscall(__NR_io_uring_enter, Fd_, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+        // EINTR and friends just make the caller look at the ring again.
+        (void)result;
+    }
+
+    template <typename F>
+    void Reap(F&& callback) {
+        unsigned head = *CqHead_;
+        const unsigned tail = AtomicLoad(CqTail_);
+        InKernel_.fetch_sub(tail - head, std::memory_order_relaxed);
+        for (; head != tail; ++head) {
+            const auto& cqe = Cqes_[head & CqMask_];
+            callback(cqe.user_data, cqe.res);
+        }
+        AtomicStore(CqHead_, head);
+    }
+
+private:
+    // Kernels before 5.6 set up rings but know neither IORING_OP_READ nor
+    // IORING_OP_WRITE, and older 5.x kernels may lack the probe as well.
+    bool SupportsOperations() const {
+        constexpr size_t ProbeOpCount = 256;
+        std::vector<char> buffer(sizeof(io_uring_probe) + ProbeOpCount * sizeof(io_uring_probe_op));
+        auto* probe = reinterpret_cast<io_uring_probe*>(buffer.data());
+        if (syscall(__NR_io_uring_register, Fd_, IORING_REGISTER_PROBE, probe, ProbeOpCount) < 0) {
+            return false;
+        }
+        for (auto operation : {IORING_OP_NOP, IORING_OP_READ, IORING_OP_WRITE, IORING_OP_FSYNC}) {
+            if (operation >= probe->ops_len || !(probe->ops[operation].flags & IO_URING_OP_SUPPORTED)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void* Map(size_t size, off_t offset) {
+        void* result = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, Fd_, offset);
+        if (result == MAP_FAILED) {
+            int error = errno;
+            Unmap();
+            THROW("Failed to map io_uring rings: {}", std::strerror(error));
+        }
+        return result;
+    }
+
+    void Unmap() {
+        if (Sqes_) {
+            munmap(Sqes_, SqesSize_);
+        }
+        if (CqRing_ && CqRing_ != SqRing_) {
+            munmap(CqRing_, CqRingSize_);
+        }
+        if (SqRing_) {
+            munmap(SqRing_, SqRingSize_);
+        }
+        if (Fd_ >= 0) {
+            close(Fd_);
+        }
+        Sqes_ = nullptr;
+        CqRing_ = SqRing_ = nullptr;
+        Fd_ = -1;
+    }
+
+    int Fd_ = -1;
+
+    void* SqRing_ = nullptr;
+    void* CqRing_ = nullptr;
+    io_uring_sqe* Sqes_ = nullptr;
+    size_t SqRingSize_ = 0;
+    size_t CqRingSize_ = 0;
+    size_t SqesSize_ = 0;
+
+    unsigned* SqHead_ = nullptr;
+    unsigned* SqTail_ = nullptr;
+    unsigned* SqArray_ = nullptr;
+    unsigned SqMask_ = 0;
+    unsigned SqEntries_ = 0;
+    unsigned LocalTail_ = 0;
+    unsigned Unsubmitted_ = 0;
+    // Entered but not reaped yet; the completion thread only wakes up while
+    // this is not zero.
+    std::atomic<unsigned> InKernel_ = 0;
+
+    unsigned* CqHead_ = nullptr;
+    unsigned* CqTail_ = nullptr;
+    io_uring_cqe* Cqes_ = nullptr;
+    unsigned CqMask_ = 0;
+    unsigned CqEntries_ = 0;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+struct TFileIOService::TReadFileState {
+    int Fd = -1;
+    // Sized for the next read; only the first Size bytes are contents.
+    std::string Data;
+    size_t Size = 0;
+    TPromise<std::string> Promise = NewPromise<std::string>();
+
+    ~TReadFileState() {
+        close(Fd);
+    }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+TFileIOService::TFileIOService(TIntrusivePtr<TInvoker> invoker, TFileIOOptions options)
+    : Invoker_(std::move(invoker))
+    , Options_(options)
+{
+    ASSERT(Invoker_, "File I/O service needs an invoker for completions");
+
+    if (Options_.Backend != EFileIOBackend::ThreadPool) {
+        try {
+            Ring_ = std::make_unique<TRing>(std::max<size_t>(Options_.QueueDepth, 2));
+        } catch (const std::exception&) {
+            if (Options_.Backend == EFileIOBackend::IOUring) {
+                throw;
+            }
+        }
+    }
+
+    if (Ring_) {
+        CompletionThread_ = std::thread(&TFileIOService::CompletionLoop, this);
+    } else {
+        auto pool = New<TThreadPool>(std::max<size_t>(Options_.FallbackThreadCount, 1));
+        FallbackInvoker_ = New<TInvoker>(std::move(pool));
+    }
+}
+
+TFileIOService::~TFileIOService() {
+    if (Ring_) {
+        {
+            std::lock_guard<std::mutex> lock(RingMutex_);
+            Stop_.store(true, std::memory_order_release);
+            // The ring has room for it: in-flight operations are capped below
+            // the ring size and pushes are always entered right away.
+            Ring_->TryPushWakeup();
+            Ring_->Enter();
+        }
+        CompletionThread_.join();
+    }
+    // The fallback pool runs whatever is queued before its workers exit.
+}
+
+const TIntrusivePtr<TFileIOService>& TFileIOService::Get() {
+    static const auto service = New<TFileIOService>(New<TInvoker>(New<TThreadPool>(1)));
+    return service;
+}
+
+EFileIOBackend TFileIOService::GetBackend() const {
+    return Ring_ ? EFileIOBackend::IOUring : EFileIOBackend::ThreadPool;
+}
+
+const TIntrusivePtr<TInvoker>& TFileIOService::GetInvoker() const {
+    return Invoker_;
+}
+
+TFuture<size_t> TFileIOService::Read(int fd, void* buffer, size_t size, uint64_t offset) {
+    return Submit({{EFileIOOperation::Read, fd, buffer, size, offset}})[0];
+}
+
+TFuture<size_t> TFileIOService::Write(int fd, const void* buffer, size_t size, uint64_t offset) {
+    // The buffer is only read from.
+    return Submit({{EFileIOOperation::Write, fd, const_cast<void*>(buffer), size, offset}})[0];
+}
+
+TFuture<void> TFileIOService::Sync(int fd, bool dataOnly) {
+    auto operation = dataOnly ? EFileIOOperation::DataSync : EFileIOOperation::Sync;
+    return Submit({{operation, fd, nullptr, 0, 0}})[0].Apply([] (size_t) {});
+}
+
+std::vector<TFuture<size_t>> TFileIOService::Submit(const std::vector<TFileIORequest>& requests) {
+    std::vector<TFuture<size_t>> futures;
+    std::vector<std::unique_ptr<TOperation>> operations;
+    futures.reserve(requests.size());
+    operations.reserve(requests.size());
+    for (const auto& request : requests) {
+        auto operation = std::make_unique<TOperation>();
+        operation->Request = request;
+        operation->Promise = NewPromise<size_t>();
+        futures.push_back(operation->Promise.ToFuture());
+        operations.push_back(std::move(operation));
+    }
+
+    if (Ring_) {
+        SubmitToRing(std::move(operations));
+    } else {
+        SubmitToPool(std::move(operations));
+    }
+    return futures;
+}
+
+TFuture<std::string> TFileIOService::ReadFile(const std::filesystem::path& path) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return MakeFuture(TErrorOr<std::string>(TException(Format("Failed to open {}: {}", path.string(), std::strerror(errno)))));
+    }
+
+    auto state = std::make_shared<TReadFileState>();
+    state->Fd = fd;
+    struct stat status;
+    // One byte over the size lets the first read see the end of file.
+    state->Data.resize(fstat(fd, &status) == 0 ? status.st_size + 1 : 0);
+
+    auto future = state->Promise.ToFuture();
+    ReadChunk(std::move(state));
+    return future;
+}
+
+void TFileIOService::ReadChunk(std::shared_ptr<TReadFileState> state) {
+    const size_t chunk = std::max({state->Data.size() - state->Size, state->Size, MinReadChunk});
+    state->Data.resize(state->Size + chunk);
+
+    Read(state->Fd, state->Data.data() + state->Size, chunk, state->Size).Subscribe(
+        [this_ = TFileIOServicePtr(this), state, chunk] (const TErrorOr<size_t>& result) {
+            if (!result) {
+                state->Promise.Set(TErrorOr<std::string>(result.Error()));
+                return;
+            }
+
+            state->Size += result.Value();
+            // Reads of a regular file only come out short at its end.
+            if (result.Value() < chunk) {
+                state->Data.resize(state->Size);
+                state->Promise.Set(std::move(state->Data));
+                return;
+            }
+            this_->ReadChunk(state);
+        });
+}
+
+void TFileIOService::SubmitToRing(std::vector<std::unique_ptr<TOperation>> operations) {
+    std::lock_guard<std::mutex> lock(RingMutex_);
+    for (auto& operation : operations) {
+        Backlog_.push_back(std::move(operation));
+    }
+    FlushRing();
+}
+
+void TFileIOService::SubmitToPool(std::vector<std::unique_ptr<TOperation>> operations) {
+    // Tasks hold the completion invoker but not the service, so the pool is
+    // never destroyed from one of its own workers.
+    for (auto& operation : operations) {
+        FallbackInvoker_->Invoke([invoker = Invoker_, operation = std::move(operation)] () mutable {
+            auto result = RunBlocking(operation->Request);
+            Complete(invoker, std::move(operation), result);
+        });
+    }
+}
+
+void TFileIOService::FlushRing() {
+    while (!Backlog_.empty() && InFlight_ < Ring_->GetCapacity()) {
+        auto& operation = Backlog_.front();
+        if (!Ring_->TryPush(operation->Request, reinterpret_cast<uint64_t>(operation.get()))) {
+            break;
+        }
+        // Owned by the ring until its completion is reaped.
+        operation.release();
+        Backlog_.pop_front();
+        ++InFlight_;
+    }
+    Ring_->Enter();
+}
+
+void TFileIOService::CompletionLoop() {
+    std::vector<std::pair<std::unique_ptr<TOperation>, int64_t>> completed;
+    while (true) {
+        Ring_->Wait();
+
+        size_t finished = 0;
+        std::vector<std::unique_ptr<TOperation>> retried;
+        Ring_->Reap([&] (uint64_t userData, int32_t result) {
+            if (userData == WakeupUserData) {
+                return;
+            }
+            ++finished;
+            std::unique_ptr<TOperation> operation(reinterpret_cast<TOperation*>(userData));
+            if (result == -EAGAIN || result == -EINTR) {
+                retried.push_back(std::move(operation));
+            } else {
+                completed.emplace_back(std::move(operation), result);
+            }
+        });
+
+        bool stop;
+        {
+            std::lock_guard<std::mutex> lock(RingMutex_);
+            InFlight_ -= finished;
+            for (auto& operation : retried) {
+                Backlog_.push_back(std::move(operation));
+            }
+            FlushRing();
+            stop = Stop_.load(std::memory_order_acquire) && InFlight_ == 0 && Backlog_.empty();
+        }
+
+        for (auto& [operation, result] : completed) {
+            Complete(Invoker_, std::move(operation), result);
+        }
+        completed.clear();
+
+        if (stop) {
+            return;
+        }
+    }
+}
+
+void TFileIOService::Complete(const TIntrusivePtr<TInvoker>& invoker, std::unique_ptr<TOperation> operation, int64_t result) {
+    const auto& request = operation->Request;
+    auto value = result >= 0
+        ? TErrorOr<size_t>(static_cast<size_t>(result))
+        : TErrorOr<size_t>(TException(Format(
+            "{} of descriptor {} failed: {}",
+            GetOperationName(request.Operation),
+            request.Fd,
+            std::strerror(-result))));
+
+    invoker->Invoke([promise = std::move(operation->Promise), value = std::move(value)] () mutable {
+        promise.Set(std::move(value));
+    });
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NCommon
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <common/future.h>
+#include <common/intrusive_ptr.h>
+#include <common/refcounted.h>
+#include <common/threadpool.h>
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace NCommon {
+
+////////////////////////////////////////////////////////////////////////////////
+
+enum class EFileIOBackend {
+    // io_uring if the kernel allows it and supports reads and writes on it,
+    // the thread pool otherwise.
+    Auto,
+    IOUring,
+    // Blocking pread/pwrite/fsync on a dedicated thread pool.
+    ThreadPool,
+};
+
+enum class EFileIOOperation {
+    Read,
+    Write,
+    Sync,
+    // fdatasync: skips metadata that is not needed to read the data back.
+    DataSync,
+};
+
+struct TFileIOOptions {
+    EFileIOBackend Backend = EFileIOBackend::Auto;
+
+    // Submission queue size of the ring. Requests beyond it wait in the
+    // service until earlier ones complete.
+    size_t QueueDepth = 128;
+
+    // Threads doing blocking I/O for the ThreadPool backend.
+    size_t FallbackThreadCount = 2;
+};
+
+struct TFileIORequest {
+    EFileIOOperation Operation = EFileIOOperation::Read;
+    int Fd = -1;
+    // Must stay valid until the request completes; unused by syncs.
+    void* Buffer = nullptr;
+    size_t Size = 0;
+    uint64_t Offset = 0;
+};
+
+// Asynchronous file I/O. With io_uring, requests are put into the submission
+// ring by the caller and a completion thread reaps the completion ring;
+// otherwise they are run as blocking calls on a small internal thread pool.
+// Either way callers never wait for the disk, and every future resolves on
+// |invoker|.
+//
+// Transfers may be short, as with pread/pwrite: a read resolves with 0 at end
+// of file. Failures resolve the future with the errno text.
+class TFileIOService
+    : public NRefCounted::TRefCountedBase
+{
+public:
+    explicit TFileIOService(TIntrusivePtr<TInvoker> invoker, TFileIOOptions options = {});
+
+    // Waits for requests in flight.
+    ~TFileIOService();
+
+    // Process-wide service that completes on a thread of its own. Used by
+    // file logging and config loading.
+    static const TIntrusivePtr<TFileIOService>& Get();
+
+    // IOUring or ThreadPool, whichever Auto ended up with.
+    EFileIOBackend GetBackend() const;
+
+    // Where futures of this service resolve.
+    const TIntrusivePtr<TInvoker>& GetInvoker() const;
+
+    TFuture<size_t> Read(int fd, void* buffer, size_t size, uint64_t offset);
+
+    TFuture<size_t> Write(int fd, const void* buffer, size_t size, uint64_t offset);
+
+    TFuture<void> Sync(int fd, bool dataOnly = false);
+
+    // Submits all |requests| with a single system call; the futures follow
+    // the order of |requests|. Requests of a batch are not ordered against
+    // each other.
+    std::vector<TFuture<size_t>> Submit(const std::vector<TFileIORequest>& requests);
+
+    // Reads the whole file. The descriptor is opened on the calling thread,
+    // the contents are read through the service.
+    TFuture<std::string> ReadFile(const std::filesystem::path& path);
+
+private:
+    struct TOperation {
+        TFileIORequest Request;
+        TPromise<size_t> Promise;
+    };
+
+    struct TReadFileState;
+    class TRing;
+
+    void SubmitToRing(std::vector<std::unique_ptr<TOperation>> operations);
+    void SubmitToPool(std::vector<std::unique_ptr<TOperation>> operations);
+
+    // Puts backlogged operations into the ring and enters it. Called with
+    // RingMutex_ held.
+    void FlushRing();
+    void CompletionLoop();
+
+    void ReadChunk(std::shared_ptr<TReadFileState> state);
+
+    // Resolves the promise of |operation| on |invoker|; |result| is a byte
+    // count or a negated errno.
+    static void Complete(const TIntrusivePtr<TInvoker>& invoker, std::unique_ptr<TOperation> operation, int64_t result);
+
+    const TIntrusivePtr<TInvoker> Invoker_;
+    const TFileIOOptions Options_;
+
+    // IOUring backend.
+    std::unique_ptr<TRing> Ring_;
+    std::thread CompletionThread_;
+    std::mutex RingMutex_;
+    std::deque<std::unique_ptr<TOperation>> Backlog_;
+    size_t InFlight_ = 0;
+    std::atomic<bool> Stop_{false};
+
+    // ThreadPool backend.
+    TIntrusivePtr<TInvoker> FallbackInvoker_;
+};
+
+DECLARE_REFCOUNTED(TFileIOService);
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NCommon
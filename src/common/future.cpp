@@ -0,0 +1,13 @@
+#include <common/future.h>
+
+namespace NCommon {
+
+////////////////////////////////////////////////////////////////////////////////
+
+TFuture<void> MakeFuture() {
+    return MakeFuture<void>(TErrorOr<void>());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NCommon
@@ -0,0 +1,164 @@
+#pragma once
+
+#include <common/intrusive_ptr.h>
+#include <common/refcounted.h>
+#include <common/task.h>
+#include <common/threadpool.h>
+
+#include <atomic>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+#include <vector>
+
+namespace NCommon {
+
+////////////////////////////////////////////////////////////////////////////////
+
+template <typename T>
+class TFuture;
+
+template <typename T>
+class TPromise;
+
+namespace NDetails {
+
+template <typename T>
+class TAllOfState;
+
+} // namespace NDetails
+
+template <typename T>
+class TFutureState
+    : public NRefCounted::TRefCountedBase
+{
+public:
+    using TCallback = TUniqueFunction<void(const TErrorOr<T>&)>;
+
+    bool IsSet() const;
+
+    // Returns false if the value has already been set.
+    bool TrySet(TErrorOr<T>&& value);
+
+    // Blocks the calling thread until the value is set.
+    const TErrorOr<T>& Get() const;
+
+    const TErrorOr<T>* TryGet() const;
+
+    // Blocks like Get. Moves the value out if the caller holds the only
+    // reference to the state, copies it otherwise.
+    TErrorOr<T> Extract();
+
+    // Runs |callback| in the thread that sets the value, or right away if the
+    // value is already there.
+    void Subscribe(TCallback callback);
+
+private:
+    mutable std::mutex Mutex_;
+    std::atomic<bool> Set_{false};
+    std::optional<TErrorOr<T>> Value_;
+    TCallback FirstCallback_;
+    std::vector<TCallback> Callbacks_;
+};
+
+// Every promise allocates a state, so they come from the pools.
+template <typename T>
+std::true_type EnablePooledAllocation(TFutureState<T>*);
+
+////////////////////////////////////////////////////////////////////////////////
+
+template <typename T>
+class TFuture {
+public:
+    using TValueType = T;
+
+    TFuture() = default;
+
+    explicit TFuture(TIntrusivePtr<TFutureState<T>> state);
+
+    explicit operator bool() const;
+
+    bool IsSet() const;
+
+    // Blocks until the value is set. Never call it from a pool thread waiting
+    // for work scheduled on the same pool.
+    const TErrorOr<T>& Get() const;
+
+    // Null until the value is set; points into the shared state, so it stays
+    // valid for as long as the future does.
+    const TErrorOr<T>* TryGet() const;
+
+    // Blocks like Get and leaves the future empty. The value is moved rather
+    // than copied if no one else refers to it any more.
+    TErrorOr<T> Extract() &&;
+
+    void Subscribe(TUniqueFunction<void(const TErrorOr<T>&)> callback) const;
+
+    // Chains |callback| on the result. The callback either accepts
+    // const TErrorOr<T>& and sees every outcome, or accepts the value (nothing
+    // for void) and is skipped on error, which is then propagated. It may
+    // return a plain value, a TErrorOr or another TFuture. Exceptions thrown
+    // by the callback resolve the returned future with an error.
+    template <typename F>
+    auto Apply(F&& callback) const;
+
+    // Same as above but the callback is run on |invoker| instead of in the
+    // thread that resolved this future.
+    template <typename F>
+    auto Apply(TIntrusivePtr<TInvoker> invoker, F&& callback) const;
+
+private:
+    friend class NDetails::TAllOfState<T>;
+
+    TIntrusivePtr<TFutureState<T>> State_;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+template <typename T>
+class TPromise {
+public:
+    TPromise() = default;
+
+    explicit TPromise(TIntrusivePtr<TFutureState<T>> state);
+
+    explicit operator bool() const;
+
+    bool IsSet() const;
+
+    void Set(TErrorOr<T> value) const;
+
+    bool TrySet(TErrorOr<T> value) const;
+
+    TFuture<T> ToFuture() const;
+
+private:
+    TIntrusivePtr<TFutureState<T>> State_;
+};
+
+template <typename T>
+TPromise<T> NewPromise();
+
+template <typename T>
+TFuture<T> MakeFuture(TErrorOr<T> value);
+
+TFuture<void> MakeFuture();
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Resolves with all values in order once every future succeeds, or with the
+// first error.
+template <typename T>
+auto AllOf(std::vector<TFuture<T>> futures);
+
+// Resolves with the first successful value, or with the last error if every
+// future fails.
+template <typename T>
+TFuture<T> AnyOf(std::vector<TFuture<T>> futures);
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NCommon
+
+// Template implementations
+#include "future_impl.h"
@@ -0,0 +1,414 @@
+#pragma once
+
+#include "future.h"
+
+namespace NCommon {
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace NDetails {
+
+template <typename T>
+struct TFutureUnwrap {
+    using TType = T;
+    static constexpr bool IsFuture = false;
+    static constexpr bool IsErrorOr = false;
+};
+
+template <typename T>
+struct TFutureUnwrap<TFuture<T>> {
+    using TType = T;
+    static constexpr bool IsFuture = true;
+    static constexpr bool IsErrorOr = false;
+};
+
+template <typename T>
+struct TFutureUnwrap<TErrorOr<T>> {
+    using TType = T;
+    static constexpr bool IsFuture = false;
+    static constexpr bool IsErrorOr = true;
+};
+
+template <typename F, typename T>
+constexpr bool AcceptsErrorOr = std::is_invocable_v<F&, const TErrorOr<T>&>;
+
+template <typename F, typename T>
+auto InvokeCallback(F& callback, const TErrorOr<T>& result) {
+    if constexpr (AcceptsErrorOr<F, T>) {
+        return std::invoke(callback, result);
+    } else if constexpr (std::is_void_v<T>) {
+        return std::invoke(callback);
+    } else {
+        return std::invoke(callback, result.Value());
+    }
+}
+
+template <typename F, typename T>
+using TApplyResult = decltype(InvokeCallback(std::declval<F&>(), std::declval<const TErrorOr<T>&>()));
+
+template <typename F, typename T>
+using TApplyFutureValue = typename TFutureUnwrap<TApplyResult<F, T>>::TType;
+
+template <typename F, typename T>
+void RunCallback(F& callback, const TErrorOr<T>& result, const TPromise<TApplyFutureValue<F, T>>& promise) {
+    using TResult = TApplyResult<F, T>;
+    using TValue = TApplyFutureValue<F, T>;
+
+    if constexpr (!AcceptsErrorOr<F, T>) {
+        if (!result) {
+            promise.Set(TErrorOr<TValue>(result.Error()));
+            return;
+        }
+    }
+
+    try {
+        if constexpr (TFutureUnwrap<TResult>::IsFuture) {
+            InvokeCallback(callback, result).Subscribe([promise] (const TErrorOr<TValue>& value) {
+                promise.Set(value);
+            });
+        } else if constexpr (TFutureUnwrap<TResult>::IsErrorOr) {
+            promise.Set(InvokeCallback(callback, result));
+        } else if constexpr (std::is_void_v<TResult>) {
+            InvokeCallback(callback, result);
+            promise.Set(TErrorOr<void>());
+        } else {
+            promise.Set(TErrorOr<TValue>(InvokeCallback(callback, result)));
+        }
+    } catch (std::exception& ex) {
+        promise.Set(TErrorOr<TValue>(ex));
+    }
+}
+
+template <typename T>
+class TAllOfState
+    : public NRefCounted::TRefCountedBase
+{
+public:
+    using TResult = std::conditional_t<std::is_void_v<T>, void, std::vector<T>>;
+
+    TAllOfState(size_t count)
+        : Remaining_(count)
+        , Promise_(NewPromise<TResult>())
+    {
+        if constexpr (!std::is_void_v<T>) {
+            Sources_.resize(count);
+        }
+    }
+
+    void Subscribe(size_t index, TFuture<T> future) {
+        // The source state holds the callback until it is set, so the callback
+        // must not hold the state; it is alive while it runs the callback.
+        auto* source = future.State_.Get();
+        future.Subscribe([this_ = TIntrusivePtr<TAllOfState>(this), index, source] (const TErrorOr<T>& result) {
+            this_->OnResult(index, source, result);
+        });
+    }
+
+    TFuture<TResult> GetFuture() const {
+        return Promise_.ToFuture();
+    }
+
+private:
+    void OnResult(size_t index, TFutureState<T>* source, const TErrorOr<T>& result) {
+        if (!result) {
+            if (!Promise_.IsSet()) {
+                Promise_.TrySet(TErrorOr<TResult>(result.Error()));
+            }
+            return;
+        }
+
+        // Values are only taken once all are there: by then most sources
+        // are referenced by nobody else and give their values up without a
+        // copy.
+        if constexpr (!std::is_void_v<T>) {
+            Sources_[index] = TFuture<T>(TIntrusivePtr<TFutureState<T>>(source));
+        }
+
+        if (Remaining_.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+            return;
+        }
+
+        if constexpr (std::is_void_v<T>) {
+            Promise_.TrySet(TErrorOr<void>());
+        } else {
+            std::vector<T> values;
+            values.reserve(Sources_.size());
+            for (auto& source : Sources_) {
+                values.push_back(std::move(source).Extract().Value());
+            }
+            Promise_.TrySet(TErrorOr<TResult>(std::move(values)));
+        }
+    }
+
+    std::atomic<size_t> Remaining_;
+    TPromise<TResult> Promise_;
+    std::conditional_t<std::is_void_v<T>, int, std::vector<TFuture<T>>> Sources_{};
+};
+
+template <typename T>
+class TAnyOfState
+    : public NRefCounted::TRefCountedBase
+{
+public:
+    TAnyOfState(size_t count)
+        : Remaining_(count)
+        , Promise_(NewPromise<T>())
+    {}
+
+    void OnResult(const TErrorOr<T>& result) {
+        // Only the result that wins is copied into the promise.
+        if (result) {
+            if (!Done_.exchange(true, std::memory_order_relaxed)) {
+                Promise_.TrySet(result);
+            }
+        } else if (Remaining_.fetch_sub(1, std::memory_order_acq_rel) == 1 &&
+            !Done_.exchange(true, std::memory_order_relaxed))
+        {
+            Promise_.TrySet(result);
+        }
+    }
+
+    TFuture<T> GetFuture() const {
+        return Promise_.ToFuture();
+    }
+
+private:
+    std::atomic<size_t> Remaining_;
+    std::atomic<bool> Done_{false};
+    TPromise<T> Promise_;
+};
+
+} // namespace NDetails
+
+////////////////////////////////////////////////////////////////////////////////
+
+template <typename T>
+bool TFutureState<T>::IsSet() const {
+    return Set_.load(std::memory_order_acquire);
+}
+
+template <typename T>
+bool TFutureState<T>::TrySet(TErrorOr<T>&& value) {
+    TCallback firstCallback;
+    std::vector<TCallback> callbacks;
+    {
+        std::lock_guard<std::mutex> lock(Mutex_);
+        if (Set_.load(std::memory_order_relaxed)) {
+            return false;
+        }
+        Value_.emplace(std::move(value));
+        Set_.store(true, std::memory_order_release);
+        firstCallback = std::move(FirstCallback_);
+        callbacks.swap(Callbacks_);
+    }
+    Set_.notify_all();
+
+    if (firstCallback) {
+        firstCallback(*Value_);
+    }
+    for (auto& callback : callbacks) {
+        callback(*Value_);
+    }
+    return true;
+}
+
+template <typename T>
+const TErrorOr<T>& TFutureState<T>::Get() const {
+    while (!Set_.load(std::memory_order_acquire)) {
+        Set_.wait(false, std::memory_order_acquire);
+    }
+    return *Value_;
+}
+
+template <typename T>
+const TErrorOr<T>* TFutureState<T>::TryGet() const {
+    return Set_.load(std::memory_order_acquire) ? &*Value_ : nullptr;
+}
+
+template <typename T>
+TErrorOr<T> TFutureState<T>::Extract() {
+    Get();
+    if (NRefCounted::IsUnique(this)) {
+        return std::move(*Value_);
+    }
+    return *Value_;
+}
+
+template <typename T>
+void TFutureState<T>::Subscribe(TCallback callback) {
+    {
+        std::lock_guard<std::mutex> lock(Mutex_);
+        if (!Set_.load(std::memory_order_relaxed)) {
+            if (!FirstCallback_) {
+                FirstCallback_ = std::move(callback);
+            } else {
+                Callbacks_.push_back(std::move(callback));
+            }
+            return;
+        }
+    }
+    callback(*Value_);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+template <typename T>
+TFuture<T>::TFuture(TIntrusivePtr<TFutureState<T>> state)
+    : State_(std::move(state))
+{}
+
+template <typename T>
+TFuture<T>::operator bool() const {
+    return static_cast<bool>(State_);
+}
+
+template <typename T>
+bool TFuture<T>::IsSet() const {
+    return State_->IsSet();
+}
+
+template <typename T>
+const TErrorOr<T>& TFuture<T>::Get() const {
+    return State_->Get();
+}
+
+template <typename T>
+const TErrorOr<T>* TFuture<T>::TryGet() const {
+    return State_->TryGet();
+}
+
+template <typename T>
+TErrorOr<T> TFuture<T>::Extract() && {
+    auto state = std::move(State_);
+    return state->Extract();
+}
+
+template <typename T>
+void TFuture<T>::Subscribe(TUniqueFunction<void(const TErrorOr<T>&)> callback) const {
+    State_->Subscribe(std::move(callback));
+}
+
+template <typename T>
+template <typename F>
+auto TFuture<T>::Apply(F&& callback) const {
+    using TCallback = std::decay_t<F>;
+    using TValue = NDetails::TApplyFutureValue<TCallback, T>;
+
+    auto promise = NewPromise<TValue>();
+    Subscribe([callback = std::forward<F>(callback), promise] (const TErrorOr<T>& result) mutable {
+        NDetails::RunCallback(callback, result, promise);
+    });
+    return promise.ToFuture();
+}
+
+template <typename T>
+template <typename F>
+auto TFuture<T>::Apply(TIntrusivePtr<TInvoker> invoker, F&& callback) const {
+    using TCallback = std::decay_t<F>;
+    using TValue = NDetails::TApplyFutureValue<TCallback, T>;
+
+    // The state holds the continuation until it is set, so the continuation
+    // must not hold the state; it is alive while it runs the continuation.
+    auto promise = NewPromise<TValue>();
+    Subscribe([
+        invoker = std::move(invoker),
+        callback = std::forward<F>(callback),
+        promise,
+        source = State_.Get()
+    ] (const TErrorOr<T>& /*result*/) mutable {
+        invoker->Invoke([
+            callback = std::move(callback),
+            promise = std::move(promise),
+            state = TIntrusivePtr<TFutureState<T>>(source)
+        ] () mutable {
+            NDetails::RunCallback(callback, state->Get(), promise);
+        });
+    });
+    return promise.ToFuture();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+template <typename T>
+TPromise<T>::TPromise(TIntrusivePtr<TFutureState<T>> state)
+    : State_(std::move(state))
+{}
+
+template <typename T>
+TPromise<T>::operator bool() const {
+    return static_cast<bool>(State_);
+}
+
+template <typename T>
+bool TPromise<T>::IsSet() const {
+    return State_->IsSet();
+}
+
+template <typename T>
+void TPromise<T>::Set(TErrorOr<T> value) const {
+    if (!State_->TrySet(std::move(value))) {
+        THROW("Promise is already set");
+    }
+}
+
+template <typename T>
+bool TPromise<T>::TrySet(TErrorOr<T> value) const {
+    return State_->TrySet(std::move(value));
+}
+
+template <typename T>
+TFuture<T> TPromise<T>::ToFuture() const {
+    return TFuture<T>(State_);
+}
+
+template <typename T>
+TPromise<T> NewPromise() {
+    return TPromise<T>(New<TFutureState<T>>());
+}
+
+template <typename T>
+TFuture<T> MakeFuture(TErrorOr<T> value) {
+    auto promise = NewPromise<T>();
+    promise.Set(std::move(value));
+    return promise.ToFuture();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+template <typename T>
+auto AllOf(std::vector<TFuture<T>> futures) {
+    if (futures.empty()) {
+        if constexpr (std::is_void_v<T>) {
+            return MakeFuture();
+        } else {
+            return MakeFuture<std::vector<T>>(std::vector<T>());
+        }
+    }
+
+    auto state = New<NDetails::TAllOfState<T>>(futures.size());
+    for (size_t index = 0; index < futures.size(); ++index) {
+        // If every future is already set, the values are extracted while the
+        // last one is being subscribed to; the vector must not share them.
+        state->Subscribe(index, std::move(futures[index]));
+    }
+    return state->GetFuture();
+}
+
+template <typename T>
+TFuture<T> AnyOf(std::vector<TFuture<T>> futures) {
+    if (futures.empty()) {
+        return MakeFuture<T>(TErrorOr<T>(TException("AnyOf called with no futures")));
+    }
+
+    auto state = New<NDetails::TAnyOfState<T>>(futures.size());
+    for (auto& future : futures) {
+        future.Subscribe([state] (const TErrorOr<T>& result) {
+            state->OnResult(result);
+        });
+    }
+    return state->GetFuture();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NCommon
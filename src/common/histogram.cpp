@@ -0,0 +1,91 @@
+#include <common/histogram.h>
+#include <common/json.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace NCommon {
+
+////////////////////////////////////////////////////////////////////////////////
+
+void THistogramSnapshot::Merge(const THistogramSnapshot& other) {
+    for (size_t i = 0; i < HistogramBucketCount; ++i) {
+        Buckets_[i] += other.Buckets_[i];
+    }
+    Count_ += other.Count_;
+    Sum_ += other.Sum_;
+    Max_ = std::max(Max_, other.Max_);
+}
+
+uint64_t THistogramSnapshot::GetCount() const {
+    return Count_;
+}
+
+uint64_t THistogramSnapshot::GetSum() const {
+    return Sum_;
+}
+
+uint64_t THistogramSnapshot::GetMax() const {
+    return Max_;
+}
+
+double THistogramSnapshot::GetMean() const {
+    return Count_ == 0 ? 0.0 : static_cast<double>(Sum_) / Count_;
+}
+
+uint64_t THistogramSnapshot::GetPercentile(double quantile) const {
+    if (Count_ == 0) {
+        return 0;
+    }
+    quantile = std::clamp(quantile, 0.0, 1.0);
+    auto rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(quantile * Count_)));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < HistogramBucketCount; ++i) {
+        seen += Buckets_[i];
+        if (seen >= rank) {
+            return std::min(THistogram::GetBucketUpperBound(i), Max_);
+        }
+    }
+    return Max_;
+}
+
+NJson::TJsonNode THistogramSnapshot::ToJson() const {
+    NJson::TJsonNode result;
+    result["count"] = Count_;
+    result["sum"] = Sum_;
+    result["mean"] = GetMean();
+    result["max"] = Max_;
+    result["p50"] = GetPercentile(0.5);
+    result["p90"] = GetPercentile(0.9);
+    result["p99"] = GetPercentile(0.99);
+    result["p999"] = GetPercentile(0.999);
+    return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+THistogramSnapshot THistogram::GetSnapshot() const {
+    THistogramSnapshot snapshot;
+    for (size_t i = 0; i < HistogramBucketCount; ++i) {
+        snapshot.Buckets_[i] = Buckets_[i].load(std::memory_order_relaxed);
+        snapshot.Count_ += snapshot.Buckets_[i];
+    }
+    snapshot.Sum_ = Sum_.load(std::memory_order_relaxed);
+    snapshot.Max_ = Max_.load(std::memory_order_relaxed);
+    return snapshot;
+}
+
+uint64_t THistogram::GetBucketUpperBound(size_t index) {
+    constexpr uint64_t Linear = uint64_t(1) << HistogramSubBucketBits;
+    if (index < Linear) {
+        return index;
+    }
+    size_t shift = (index >> HistogramSubBucketBits) - 1;
+    uint64_t subBucket = index & (Linear - 1);
+    uint64_t lower = (Linear + subBucket) << shift;
+    return lower + ((uint64_t(1) << shift) - 1);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NCommon
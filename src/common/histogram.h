@@ -0,0 +1,89 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace NJson {
+
+class TJsonNode;
+
+} // namespace NJson
+
+namespace NCommon {
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Log-linear bucketing: values below 4 get their own bucket, every larger
+// power of two is split into four, so a bucket bound is within 25% of any
+// value in it.
+constexpr size_t HistogramSubBucketBits = 2;
+constexpr size_t HistogramBucketCount = (64 - HistogramSubBucketBits + 1) << HistogramSubBucketBits;
+
+class THistogramSnapshot {
+public:
+    void Merge(const THistogramSnapshot& other);
+
+    uint64_t GetCount() const;
+    uint64_t GetSum() const;
+    uint64_t GetMax() const;
+    double GetMean() const;
+
+    // Upper bound of the bucket holding the |quantile| sample, clamped to the
+    // maximum; 0 for an empty histogram.
+    uint64_t GetPercentile(double quantile) const;
+
+    // {"count", "sum", "mean", "max", "p50", "p90", "p99", "p999"}.
+    NJson::TJsonNode ToJson() const;
+
+private:
+    friend class THistogram;
+
+    std::array<uint64_t, HistogramBucketCount> Buckets_{};
+    uint64_t Count_ = 0;
+    uint64_t Sum_ = 0;
+    uint64_t Max_ = 0;
+};
+
+// Wait-free histogram for a single writer. Readers on other threads take
+// snapshots with relaxed loads; per-thread instances are merged on read.
+class THistogram {
+public:
+    void Record(uint64_t value) {
+        Bump(Buckets_[GetBucketIndex(value)], 1);
+        Bump(Sum_, value);
+        if (value > Max_.load(std::memory_order_relaxed)) {
+            Max_.store(value, std::memory_order_relaxed);
+        }
+    }
+
+    THistogramSnapshot GetSnapshot() const;
+
+    static size_t GetBucketIndex(uint64_t value) {
+        constexpr uint64_t Linear = uint64_t(1) << HistogramSubBucketBits;
+        if (value < Linear) {
+            return value;
+        }
+        size_t exponent = 63 - __builtin_clzll(value);
+        size_t shift = exponent - HistogramSubBucketBits;
+        size_t subBucket = (value >> shift) & (Linear - 1);
+        return ((shift + 1) << HistogramSubBucketBits) + subBucket;
+    }
+
+    static uint64_t GetBucketUpperBound(size_t index);
+
+private:
+    static void Bump(std::atomic<uint64_t>& counter, uint64_t delta) {
+        // Single writer: no read-modify-write needed.
+        counter.store(counter.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+    }
+
+    std::array<std::atomic<uint64_t>, HistogramBucketCount> Buckets_{};
+    std::atomic<uint64_t> Sum_{0};
+    std::atomic<uint64_t> Max_{0};
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NCommon
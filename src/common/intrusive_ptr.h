@@ -2,6 +2,8 @@
 
 #include <common/refcounted.h>
 
+#include <type_traits>
+
 namespace NCommon {
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -42,6 +44,28 @@ public:
         other.ptr_ = nullptr;
     }
 
+    // Upcasts share the ref counter prefix, so the derived type must keep the
+    // base's alignment and be reachable without a pointer adjustment. The base
+    // frees the block, so both must agree on whether it came from the pools.
+    template <typename U>
+    requires std::is_convertible_v<U*, T*>
+    TIntrusivePtr(const TIntrusivePtr<U>& other)
+        : TIntrusivePtr(static_cast<T*>(other.Get()))
+    {
+        static_assert(alignof(U) == alignof(T));
+        static_assert(NRefCounted::PooledRefCounted<U> == NRefCounted::PooledRefCounted<T>);
+    }
+
+    template <typename U>
+    requires std::is_convertible_v<U*, T*>
+    TIntrusivePtr(TIntrusivePtr<U>&& other) noexcept
+        : ptr_(other.ptr_)
+    {
+        static_assert(alignof(U) == alignof(T));
+        static_assert(NRefCounted::PooledRefCounted<U> == NRefCounted::PooledRefCounted<T>);
+        other.ptr_ = nullptr;
+    }
+
     TIntrusivePtr& operator=(const TIntrusivePtr& other) {
         if (this != &other) {
             reset();
@@ -78,6 +102,10 @@ public:
         return ptr_;
     }
 
+    T* Get() const {
+        return ptr_;
+    }
+
     void reset() {
         if (ptr_) {
             NRefCounted::Unref(ptr_);
@@ -99,6 +127,9 @@ private:
     template <typename U>
     friend class TWeakPtr;
 
+    template <typename U>
+    friend class TIntrusivePtr;
+
     template <typename U, typename... Args>
     friend TIntrusivePtr<U> New(Args&&... args);
 };
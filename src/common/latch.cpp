@@ -0,0 +1,47 @@
+#include <common/latch.h>
+
+#include <thread>
+
+namespace NCommon {
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+constexpr int LatchSpinCount = 64;
+
+} // namespace
+
+TCountDownLatch::TCountDownLatch(size_t count)
+    : Count_(count)
+{}
+
+bool TCountDownLatch::CountDown(size_t n) {
+    if (Count_.fetch_sub(n, std::memory_order_acq_rel) != n) {
+        return false;
+    }
+    Count_.notify_all();
+    return true;
+}
+
+bool TCountDownLatch::TryWait() const {
+    return Count_.load(std::memory_order_acquire) == 0;
+}
+
+void TCountDownLatch::Wait() const {
+    for (int i = 0; i < LatchSpinCount; ++i) {
+        if (TryWait()) {
+            return;
+        }
+        std::this_thread::yield();
+    }
+
+    size_t count;
+    while ((count = Count_.load(std::memory_order_acquire)) != 0) {
+        Count_.wait(count, std::memory_order_acquire);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NCommon
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+namespace NCommon {
+
+////////////////////////////////////////////////////////////////////////////////
+
+// One-shot completion latch: a single atomic counter, waiters spin briefly and
+// then sleep on the counter itself.
+class TCountDownLatch {
+public:
+    explicit TCountDownLatch(size_t count);
+
+    // Returns true for the call that brought the counter to zero.
+    bool CountDown(size_t n = 1);
+
+    bool TryWait() const;
+
+    void Wait() const;
+
+private:
+    std::atomic<size_t> Count_;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NCommon
@@ -1,7 +1,15 @@
+#include <common/file_io.h>
 #include <common/logging.h>
+#include <algorithm>
+#include <condition_variable>
 #include <filesystem>
+#include <sstream>
 #include <thread>
 
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 namespace NLogging {
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -44,31 +52,216 @@ void TStreamHandler::Handle(const TLogEntry& entry) {
 
 ////////////////////////////////////////////////////////////////////////////////
 
-TFileHandler::TFileHandler(const std::string& filename)
-    : filename_(filename)
-{
-    file_.open(filename, std::ios::out | std::ios::app);
-    if (!file_.is_open()) {
-        throw std::runtime_error("Failed to open log file: " + filename);
+class TFileHandler::TImpl : public std::enable_shared_from_this<TImpl> {
+public:
+    explicit TImpl(const std::string& filename)
+        : filename_(filename)
+        , service_(NCommon::TFileIOService::Get())
+    {
+        Open();
     }
     
-    file_.seekp(0, std::ios::end);
-    currentFileSize_ = file_.tellp();
-    file_.seekp(0, std::ios::end);
-}
-
-TFileHandler::~TFileHandler() {
-    if (file_.is_open()) {
-        file_.close();
+    ~TImpl() {
+        close(fd_);
     }
-}
+    
+    void SetMaxFileSize(size_t maxSizeBytes) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        maxFileSize_ = maxSizeBytes;
+    }
+    
+    void SetMaxBackupCount(size_t count) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        maxBackupCount_ = count;
+    }
+    
+    void Append(const std::string& message) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            pending_ += message;
+            if (writing_) {
+                return;
+            }
+            writing_ = true;
+            
+            if (fd_ < 0 || currentFileSize_ + pending_.size() > maxFileSize_) {
+                // Renames and reopening block on disk, so they are left to
+                // the I/O service's invoker.
+                service_->GetInvoker()->Invoke([this_ = shared_from_this()] {
+                    this_->WriteNext();
+                });
+                return;
+            }
+            batch_.swap(pending_);
+        }
+        WriteBatch();
+    }
+    
+    void Flush() {
+        // The writes complete on the service's thread, waiting there would
+        // never return.
+        if (service_->GetInvoker()->GetThreadPool()->IsWorkerThread()) {
+            return;
+        }
+        std::unique_lock<std::mutex> lock(mutex_);
+        drained_.wait(lock, [this] { return !writing_; });
+    }
+    
+private:
+    void Open() {
+        fd_ = open(filename_.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (fd_ < 0) {
+            throw std::runtime_error("Failed to open log file: " + filename_);
+        }
+        
+        struct stat status;
+        size_t size = fstat(fd_, &status) == 0 ? status.st_size : 0;
+        std::lock_guard<std::mutex> lock(mutex_);
+        currentFileSize_ = size;
+    }
+    
+    // The writer: runs with writing_ set, one batch at a time, so batch_,
+    // fd_ and currentFileSize_ only change here.
+    void WriteNext() {
+        bool rotate;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (pending_.empty()) {
+                writing_ = false;
+                drained_.notify_all();
+                return;
+            }
+            rotate = currentFileSize_ + pending_.size() > maxFileSize_;
+            batch_.swap(pending_);
+        }
+        
+        if (rotate) {
+            try {
+                RotateLogFile();
+            } catch (const std::exception& ex) {
+                // Logging from here would come back to this handler.
+                std::cerr << "Failed to rotate log file " << filename_ << ": " << ex.what() << std::endl;
+            }
+        }
+        if (fd_ < 0) {
+            try {
+                Open();
+            } catch (const std::exception& ex) {
+                std::cerr << ex.what() << std::endl;
+                Suspend();
+                return;
+            }
+        }
+        WriteBatch();
+    }
+    
+    void WriteBatch() {
+        // The descriptor is opened with O_APPEND, the offset is only a hint.
+        service_->Write(fd_, batch_.data(), batch_.size(), currentFileSize_).Subscribe(
+            [this_ = shared_from_this()] (const NCommon::TErrorOr<size_t>& result) {
+                this_->OnWritten(result);
+            });
+    }
+    
+    void OnWritten(const NCommon::TErrorOr<size_t>& result) {
+        if (result && result.Value() > 0) {
+            batch_.erase(0, result.Value());
+            std::lock_guard<std::mutex> lock(mutex_);
+            currentFileSize_ += result.Value();
+        } else {
+            std::cerr << "Failed to write log file " << filename_ << ": "
+                      << (result ? "nothing written" : result.Error().what()) << std::endl;
+            Suspend();
+            return;
+        }
+        
+        if (!batch_.empty()) {
+            WriteBatch();
+        } else {
+            WriteNext();
+        }
+    }
+    
+    // Puts the unwritten batch back ahead of the pending entries and stops
+    // writing; the next Append retries, so a failing disk is not spun on.
+    void Suspend() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending_.insert(0, batch_);
+        batch_.clear();
+        writing_ = false;
+        drained_.notify_all();
+    }
+    
+    // Runs without mutex_, so that Handle does not wait for the renames.
+    void RotateLogFile() {
+        size_t maxBackupCount;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            maxBackupCount = maxBackupCount_;
+        }
+        
+        close(fd_);
+        fd_ = -1;
+        
+        std::string oldestBackup = filename_ + "." + std::to_string(maxBackupCount);
+        if (std::filesystem::exists(oldestBackup)) {
+            std::filesystem::remove(oldestBackup);
+        }
+        
+        for (int i = maxBackupCount - 1; i > 0; --i) {
+            std::string oldName = filename_ + "." + std::to_string(i);
+            std::string newName = filename_ + "." + std::to_string(i + 1);
+            
+            if (std::filesystem::exists(oldName)) {
+                std::filesystem::rename(oldName, newName);
+            }
+        }
+        
+        std::string backupName = filename_ + ".1";
+        std::filesystem::rename(filename_, backupName);
+        
+        fd_ = open(filename_.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+        if (fd_ < 0) {
+            throw std::runtime_error("Failed to open new log file after rotation: " + filename_);
+        }
+        
+        std::lock_guard<std::mutex> lock(mutex_);
+        currentFileSize_ = 0;
+    }
+    
+    const std::string filename_;
+    // Held so that the service outlives writes still in flight at exit.
+    const NCommon::TFileIOServicePtr service_;
+    int fd_ = -1;
+    
+    std::mutex mutex_;
+    std::condition_variable drained_;
+    size_t maxFileSize_ = 10 * 1024 * 1024; // 10 MB default
+    size_t maxBackupCount_ = 5;
+    size_t currentFileSize_ = 0;
+    // Entries handled since the last write was issued.
+    std::string pending_;
+    std::string batch_;
+    bool writing_ = false;
+};
+
+TFileHandler::TFileHandler(const std::string& filename)
+    : impl_(std::make_shared<TImpl>(filename))
+{ }
+
+// Writes in flight hold on to the impl, so nothing is waited for here.
+TFileHandler::~TFileHandler() = default;
 
 void TFileHandler::SetMaxFileSize(size_t maxSizeBytes) {
-    maxFileSize_ = maxSizeBytes;
+    impl_->SetMaxFileSize(maxSizeBytes);
 }
 
 void TFileHandler::SetMaxBackupCount(size_t count) {
-    maxBackupCount_ = count;
+    impl_->SetMaxBackupCount(count);
+}
+
+void TFileHandler::Flush() {
+    impl_->Flush();
 }
 
 void TFileHandler::Handle(const TLogEntry& entry) {
@@ -91,44 +284,8 @@ void TFileHandler::Handle(const TLogEntry& entry) {
          << entry.message
          << "\t[thread:" << std::hex << threadHash << "]"
          << std::endl;
-                 
-    std::string formattedMessage = messageStream.str();
-    
-    if (currentFileSize_ + formattedMessage.size() > maxFileSize_) {
-        RotateLogFile();
-    }
-    
-    file_ << formattedMessage;
-    file_.flush();
-    currentFileSize_ += formattedMessage.size();
-}
-
-void TFileHandler::RotateLogFile() {
-    file_.close();
-    
-    std::string oldestBackup = filename_ + "." + std::to_string(maxBackupCount_);
-    if (std::filesystem::exists(oldestBackup)) {
-        std::filesystem::remove(oldestBackup);
-    }
-    
-    for (int i = maxBackupCount_ - 1; i > 0; --i) {
-        std::string oldName = filename_ + "." + std::to_string(i);
-        std::string newName = filename_ + "." + std::to_string(i + 1);
-        
-        if (std::filesystem::exists(oldName)) {
-            std::filesystem::rename(oldName, newName);
-        }
-    }
-    
-    std::string backupName = filename_ + ".1";
-    std::filesystem::rename(filename_, backupName);
-    
-    file_.open(filename_, std::ios::out);
-    if (!file_.is_open()) {
-        throw std::runtime_error("Failed to open new log file after rotation: " + filename_);
-    }
     
-    currentFileSize_ = 0;
+    impl_->Append(messageStream.str());
 }
 
 ////////////////////////////////////////////////////////////////////////////////
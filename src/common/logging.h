@@ -67,9 +67,14 @@ private:
     std::ostream& stream_;
 };
 
+// Appends entries through NCommon::TFileIOService, so Handle only formats
+// and queues. Entries handled while a write is in flight go out with the next
+// one; rotation happens on the I/O service's invoker.
 class TFileHandler : public THandler {
 public:
     explicit TFileHandler(const std::string& filename);
+    // Does not wait: entries still being written keep the file open until
+    // they are done. Call Flush to wait for them.
     ~TFileHandler() override;
     
     void Handle(const TLogEntry& entry) override;
@@ -78,14 +83,15 @@ public:
     
     void SetMaxBackupCount(size_t count);
     
+    // Blocks until every entry handled so far has been written, or kept back
+    // for a retry after a failed write. Returns at once on the thread of the
+    // file I/O service, which the writes themselves need.
+    void Flush();
+    
 private:
-    void RotateLogFile();
+    class TImpl;
     
-    std::ofstream file_;
-    std::string filename_;
-    size_t maxFileSize_ = 10 * 1024 * 1024; // 10 MB default
-    size_t maxBackupCount_ = 5;
-    size_t currentFileSize_ = 0;
+    std::shared_ptr<TImpl> impl_;
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1 @@
+#include <common/mpmc_queue.h>
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+
+namespace NCommon {
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Bounded multi-producer/multi-consumer queue (Vyukov). Every cell carries a
+// sequence number that tells producers and consumers whose turn it is, so both
+// sides only contend on a single CAS of their position counter.
+template <typename T>
+class TBoundedMpmcQueue {
+public:
+    explicit TBoundedMpmcQueue(size_t capacity)
+        : Mask_(RoundUpToPowerOfTwo(capacity) - 1),
+          Cells_(std::make_unique<TCell[]>(Mask_ + 1))
+    {
+        for (size_t i = 0; i <= Mask_; ++i) {
+            Cells_[i].Sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    ~TBoundedMpmcQueue() {
+        T value;
+        while (TryPop(value)) {
+        }
+    }
+
+    TBoundedMpmcQueue(const TBoundedMpmcQueue&) = delete;
+    TBoundedMpmcQueue& operator=(const TBoundedMpmcQueue&) = delete;
+
+    // Leaves |value| untouched when the queue is full.
+    bool TryPush(T&& value) {
+        TCell* cell;
+        size_t pos = EnqueuePos_.load(std::memory_order_relaxed);
+        while (true) {
+            cell = &Cells_[pos & Mask_];
+            size_t seq = cell->Sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+            if (diff == 0) {
+                if (EnqueuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = EnqueuePos_.load(std::memory_order_relaxed);
+            }
+        }
+
+        new (cell->Storage) T(std::move(value));
+        cell->Sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool TryPop(T& value) {
+        TCell* cell;
+        size_t pos = DequeuePos_.load(std::memory_order_relaxed);
+        while (true) {
+            cell = &Cells_[pos & Mask_];
+            size_t seq = cell->Sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos + 1);
+            if (diff == 0) {
+                if (DequeuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = DequeuePos_.load(std::memory_order_relaxed);
+            }
+        }
+
+        T* stored = std::launder(reinterpret_cast<T*>(cell->Storage));
+        value = std::move(*stored);
+        stored->~T();
+        cell->Sequence.store(pos + Mask_ + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Approximate under concurrent access. A producer that has claimed a slot
+    // but not yet published it counts as present.
+    size_t SizeApprox() const {
+        size_t head = DequeuePos_.load(std::memory_order_relaxed);
+        size_t tail = EnqueuePos_.load(std::memory_order_relaxed);
+        return tail > head ? tail - head : 0;
+    }
+
+    bool Empty() const {
+        return SizeApprox() == 0;
+    }
+
+    size_t Capacity() const {
+        return Mask_ + 1;
+    }
+
+private:
+    static constexpr size_t CacheLineSize = 64;
+
+    struct TCell {
+        std::atomic<size_t> Sequence;
+        alignas(T) unsigned char Storage[sizeof(T)];
+    };
+
+    static size_t RoundUpToPowerOfTwo(size_t value) {
+        size_t result = 2;
+        while (result < value) {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    const size_t Mask_;
+    const std::unique_ptr<TCell[]> Cells_;
+
+    alignas(CacheLineSize) std::atomic<size_t> EnqueuePos_{0};
+    alignas(CacheLineSize) std::atomic<size_t> DequeuePos_{0};
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NCommon
@@ -0,0 +1,93 @@
+#include <common/parallel.h>
+#include <common/latch.h>
+
+#include <algorithm>
+#include <exception>
+
+namespace NCommon {
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace NDetails {
+
+namespace {
+
+class TParallelState
+    : public NRefCounted::TRefCountedBase
+{
+public:
+    TParallelState(size_t chunkCount, TUniqueFunction<void(size_t)> body)
+        : ChunkCount_(chunkCount)
+        , Body_(std::move(body))
+        , Latch_(chunkCount)
+    {}
+
+    // Helpers scheduled after the last chunk has been claimed find nothing to
+    // do and never touch |Body_|, which may refer to a finished caller frame.
+    void RunChunks() {
+        while (true) {
+            size_t chunk = NextChunk_.fetch_add(1, std::memory_order_relaxed);
+            if (chunk >= ChunkCount_) {
+                return;
+            }
+
+            if (!Failed_.load(std::memory_order_relaxed)) {
+                try {
+                    Body_(chunk);
+                } catch (...) {
+                    if (!Failed_.exchange(true, std::memory_order_relaxed)) {
+                        Error_ = std::current_exception();
+                    }
+                }
+            }
+            Latch_.CountDown();
+        }
+    }
+
+    void Wait() {
+        Latch_.Wait();
+        if (Error_) {
+            std::rethrow_exception(Error_);
+        }
+    }
+
+private:
+    const size_t ChunkCount_;
+    TUniqueFunction<void(size_t)> Body_;
+    std::atomic<size_t> NextChunk_{0};
+    TCountDownLatch Latch_;
+    std::atomic<bool> Failed_{false};
+    std::exception_ptr Error_;
+};
+
+} // namespace
+
+size_t GetChunkCount(const TIntrusivePtr<TInvoker>& invoker, size_t size, const TParallelOptions& options) {
+    const auto& pool = invoker->GetThreadPool();
+    // The calling thread takes part unless it already is one of the workers.
+    size_t threads = pool->GetThreadCount() + (pool->IsWorkerThread() ? 0 : 1);
+    size_t byGrain = size / std::max<size_t>(options.MinGrainSize, 1);
+    size_t byThreads = threads * std::max<size_t>(options.ChunksPerThread, 1);
+    return std::max<size_t>(1, std::min(byGrain, byThreads));
+}
+
+void RunChunked(const TIntrusivePtr<TInvoker>& invoker, size_t chunkCount, TUniqueFunction<void(size_t)> body) {
+    auto state = New<TParallelState>(chunkCount, std::move(body));
+
+    const auto& pool = invoker->GetThreadPool();
+    size_t helpers = std::min(chunkCount - 1, pool->GetThreadCount());
+    for (size_t i = 0; i < helpers; ++i) {
+        invoker->Invoke([state] {
+            state->RunChunks();
+        });
+    }
+
+    state->RunChunks();
+    state->Wait();
+}
+
+} // namespace NDetails
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NCommon
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <common/intrusive_ptr.h>
+#include <common/task.h>
+#include <common/threadpool.h>
+
+#include <cstddef>
+#include <functional>
+
+namespace NCommon {
+
+////////////////////////////////////////////////////////////////////////////////
+
+struct TParallelOptions {
+    // Smallest range worth a separate chunk.
+    size_t MinGrainSize = 1;
+
+    // Chunks per participating thread; more chunks balance uneven iterations
+    // at the price of more atomic increments.
+    size_t ChunksPerThread = 4;
+};
+
+namespace NDetails {
+
+// Number of chunks to split |size| iterations into for |invoker|.
+size_t GetChunkCount(const TIntrusivePtr<TInvoker>& invoker, size_t size, const TParallelOptions& options);
+
+// Runs body(chunk) for every chunk in [0, chunkCount). Pool helpers and the
+// calling thread claim chunks from a shared counter; the caller only waits for
+// chunks that are already running elsewhere. Rethrows the first exception.
+void RunChunked(const TIntrusivePtr<TInvoker>& invoker, size_t chunkCount, TUniqueFunction<void(size_t)> body);
+
+} // namespace NDetails
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Calls body(i) for every i in [begin, end).
+template <typename F>
+void ParallelFor(
+    const TIntrusivePtr<TInvoker>& invoker,
+    size_t begin,
+    size_t end,
+    F&& body,
+    const TParallelOptions& options = {});
+
+// out[i] = transform(first[i]) for random access iterators.
+template <typename TInputIt, typename TOutputIt, typename F>
+void ParallelTransform(
+    const TIntrusivePtr<TInvoker>& invoker,
+    TInputIt first,
+    TInputIt last,
+    TOutputIt out,
+    F&& transform,
+    const TParallelOptions& options = {});
+
+// Folds map(i) for i in [begin, end) with an associative |reduce|; |identity|
+// seeds every chunk.
+template <typename T, typename TMap, typename TReduce>
+T ParallelReduce(
+    const TIntrusivePtr<TInvoker>& invoker,
+    size_t begin,
+    size_t end,
+    T identity,
+    TMap&& map,
+    TReduce&& reduce,
+    const TParallelOptions& options = {});
+
+// Stable merge sort: chunks are sorted in parallel and then merged pairwise,
+// every merge being split further so that each round keeps all threads busy.
+// The value type must be default constructible.
+template <typename TIt, typename TCompare = std::less<>>
+void ParallelSort(
+    const TIntrusivePtr<TInvoker>& invoker,
+    TIt first,
+    TIt last,
+    TCompare compare = {},
+    const TParallelOptions& options = {});
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NCommon
+
+// Template implementations
+#include "parallel_impl.h"
@@ -0,0 +1,224 @@
+#pragma once
+
+#include "parallel.h"
+
+#include <algorithm>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+namespace NCommon {
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace NDetails {
+
+// Start of |chunk| when |size| items are split into |chunkCount| near-equal
+// contiguous chunks.
+inline size_t GetChunkBegin(size_t size, size_t chunkCount, size_t chunk) {
+    return size / chunkCount * chunk + std::min(chunk, size % chunkCount);
+}
+
+// Sorting runs shorter than this is cheaper than scheduling them.
+constexpr size_t MinParallelSortRun = 2048;
+
+} // namespace NDetails
+
+////////////////////////////////////////////////////////////////////////////////
+
+template <typename F>
+void ParallelFor(
+    const TIntrusivePtr<TInvoker>& invoker,
+    size_t begin,
+    size_t end,
+    F&& body,
+    const TParallelOptions& options)
+{
+    if (end <= begin) {
+        return;
+    }
+
+    const size_t size = end - begin;
+    const size_t chunkCount = NDetails::GetChunkCount(invoker, size, options);
+    if (chunkCount == 1) {
+        for (size_t i = begin; i < end; ++i) {
+            body(i);
+        }
+        return;
+    }
+
+    NDetails::RunChunked(invoker, chunkCount, [&] (size_t chunk) {
+        size_t from = begin + NDetails::GetChunkBegin(size, chunkCount, chunk);
+        size_t to = begin + NDetails::GetChunkBegin(size, chunkCount, chunk + 1);
+        for (size_t i = from; i < to; ++i) {
+            body(i);
+        }
+    });
+}
+
+template <typename TInputIt, typename TOutputIt, typename F>
+void ParallelTransform(
+    const TIntrusivePtr<TInvoker>& invoker,
+    TInputIt first,
+    TInputIt last,
+    TOutputIt out,
+    F&& transform,
+    const TParallelOptions& options)
+{
+    ParallelFor(invoker, 0, static_cast<size_t>(last - first), [&] (size_t i) {
+        out[i] = transform(first[i]);
+    }, options);
+}
+
+template <typename T, typename TMap, typename TReduce>
+T ParallelReduce(
+    const TIntrusivePtr<TInvoker>& invoker,
+    size_t begin,
+    size_t end,
+    T identity,
+    TMap&& map,
+    TReduce&& reduce,
+    const TParallelOptions& options)
+{
+    if (end <= begin) {
+        return identity;
+    }
+
+    const size_t size = end - begin;
+    const size_t chunkCount = NDetails::GetChunkCount(invoker, size, options);
+    if (chunkCount == 1) {
+        T result = identity;
+        for (size_t i = begin; i < end; ++i) {
+            result = reduce(std::move(result), map(i));
+        }
+        return result;
+    }
+
+    std::vector<T> partials(chunkCount, identity);
+    NDetails::RunChunked(invoker, chunkCount, [&] (size_t chunk) {
+        size_t from = begin + NDetails::GetChunkBegin(size, chunkCount, chunk);
+        size_t to = begin + NDetails::GetChunkBegin(size, chunkCount, chunk + 1);
+        T partial = identity;
+        for (size_t i = from; i < to; ++i) {
+            partial = reduce(std::move(partial), map(i));
+        }
+        partials[chunk] = std::move(partial);
+    });
+
+    T result = std::move(identity);
+    for (auto& partial : partials) {
+        result = reduce(std::move(result), std::move(partial));
+    }
+    return result;
+}
+
+template <typename TIt, typename TCompare>
+void ParallelSort(
+    const TIntrusivePtr<TInvoker>& invoker,
+    TIt first,
+    TIt last,
+    TCompare compare,
+    const TParallelOptions& options)
+{
+    using TValue = typename std::iterator_traits<TIt>::value_type;
+
+    const size_t size = last - first;
+
+    TParallelOptions runOptions;
+    runOptions.MinGrainSize = std::max(options.MinGrainSize, NDetails::MinParallelSortRun);
+    runOptions.ChunksPerThread = 1;
+    const size_t runCount = NDetails::GetChunkCount(invoker, size, runOptions);
+    if (runCount <= 1) {
+        std::stable_sort(first, last, compare);
+        return;
+    }
+
+    std::vector<size_t> bounds(runCount + 1);
+    for (size_t run = 0; run <= runCount; ++run) {
+        bounds[run] = NDetails::GetChunkBegin(size, runCount, run);
+    }
+
+    TParallelOptions taskOptions;
+    taskOptions.ChunksPerThread = 1;
+
+    ParallelFor(invoker, 0, runCount, [&] (size_t run) {
+        std::stable_sort(first + bounds[run], first + bounds[run + 1], compare);
+    }, taskOptions);
+
+    const size_t targetPieces = NDetails::GetChunkCount(invoker, size, options);
+    std::vector<TValue> buffer(size);
+
+    auto mergeRound = [&] (auto src, auto dst) {
+        const size_t runs = bounds.size() - 1;
+        const size_t pairs = (runs + 1) / 2;
+        const size_t pieces = std::max<size_t>(1, targetPieces / pairs);
+
+        // Split points are computed before any element is moved out of |src|.
+        std::vector<size_t> splits(pairs * (pieces + 1));
+        ParallelFor(invoker, 0, pairs * (pieces + 1), [&] (size_t task) {
+            size_t pair = task / (pieces + 1);
+            size_t piece = task % (pieces + 1);
+            size_t lo = bounds[2 * pair];
+            size_t mid = bounds[std::min(2 * pair + 1, runs)];
+            size_t hi = bounds[std::min(2 * pair + 2, runs)];
+
+            size_t aIndex = lo + NDetails::GetChunkBegin(mid - lo, pieces, piece);
+            if (piece == 0) {
+                splits[task] = mid;
+            } else if (aIndex == mid) {
+                splits[task] = hi;
+            } else {
+                splits[task] = std::lower_bound(src + mid, src + hi, src[aIndex], compare) - src;
+            }
+        }, taskOptions);
+
+        ParallelFor(invoker, 0, pairs * pieces, [&] (size_t task) {
+            size_t pair = task / pieces;
+            size_t piece = task % pieces;
+            size_t lo = bounds[2 * pair];
+            size_t mid = bounds[std::min(2 * pair + 1, runs)];
+
+            size_t aFrom = lo + NDetails::GetChunkBegin(mid - lo, pieces, piece);
+            size_t aTo = lo + NDetails::GetChunkBegin(mid - lo, pieces, piece + 1);
+            size_t bFrom = splits[pair * (pieces + 1) + piece];
+            size_t bTo = splits[pair * (pieces + 1) + piece + 1];
+
+            std::merge(
+                std::make_move_iterator(src + aFrom),
+                std::make_move_iterator(src + aTo),
+                std::make_move_iterator(src + bFrom),
+                std::make_move_iterator(src + bTo),
+                dst + aFrom + (bFrom - mid),
+                compare);
+        }, taskOptions);
+
+        std::vector<size_t> merged;
+        for (size_t i = 0; i < bounds.size(); i += 2) {
+            merged.push_back(bounds[i]);
+        }
+        if (merged.back() != size) {
+            merged.push_back(size);
+        }
+        bounds.swap(merged);
+    };
+
+    bool inBuffer = false;
+    while (bounds.size() > 2) {
+        if (inBuffer) {
+            mergeRound(buffer.begin(), first);
+        } else {
+            mergeRound(first, buffer.begin());
+        }
+        inBuffer = !inBuffer;
+    }
+
+    if (inBuffer) {
+        ParallelFor(invoker, 0, size, [&] (size_t i) {
+            first[i] = std::move(buffer[i]);
+        }, options);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NCommon
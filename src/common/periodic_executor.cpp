@@ -1,35 +1,111 @@
 #include <common/exception.h>
+#include <common/logging.h>
 #include <common/periodic_executor.h>
 #include <common/threadpool.h>
 #include <common/weak_ptr.h>
 
-#include <thread>
+#include <random>
 
 namespace NCommon {
 
 ////////////////////////////////////////////////////////////////////////////////
 
+namespace {
+
+// Uniform value in [-1, 1].
+double GetRandomShift() {
+    thread_local std::minstd_rand generator(std::random_device{}());
+    return std::uniform_real_distribution<double>(-1.0, 1.0)(generator);
+}
+
+TPeriodicExecutorOptions MakeFixedDelayOptions(std::chrono::milliseconds delay) {
+    TPeriodicExecutorOptions options;
+    options.Period = delay;
+    return options;
+}
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////
+
 TPeriodicExecutor::TPeriodicExecutor(
     std::function<bool()> callback,
     TIntrusivePtr<TInvoker> invoker,
     std::chrono::milliseconds delay
+) : TPeriodicExecutor(
+        std::move(callback),
+        std::move(invoker),
+        MakeFixedDelayOptions(delay))
+{}
+
+TPeriodicExecutor::TPeriodicExecutor(
+    std::function<bool()> callback,
+    TIntrusivePtr<TInvoker> invoker,
+    TPeriodicExecutorOptions options
 ) : Callback_(std::move(callback)),
     Invoker_(std::move(invoker)),
-    Delay_(delay)
+    Options_(options)
 {}
 
+TPeriodicExecutor::~TPeriodicExecutor() {
+    Stop();
+}
+
 void TPeriodicExecutor::Start() {
-    ScheduleNext();
+    if (Options_.CancellationToken.CanBeCancelled()) {
+        // Runs Stop right away if the token is already cancelled.
+        auto cookie = Options_.CancellationToken.Subscribe([this_ = TWeakPtr<TPeriodicExecutor>(this)] {
+            if (auto strong = this_.Lock()) {
+                strong->Stop();
+            }
+        });
+        std::lock_guard<std::mutex> lock(CookieMutex_);
+        CancellationCookie_ = cookie;
+    }
+
+    auto splay = std::chrono::duration_cast<TClock::duration>(
+        Options_.Splay * (GetRandomShift() + 1.0) / 2.0);
+    NextDeadline_ = TClock::now() + splay;
+    if (splay == TClock::duration::zero()) {
+        ScheduleNext();
+    } else {
+        ScheduleAt(NextDeadline_);
+    }
 }
 
 void TPeriodicExecutor::Stop() {
     StopFlag_.store(true, std::memory_order_relaxed);
+
+    std::lock_guard<std::mutex> lock(CookieMutex_);
+    TDelayedExecutor::Get().Cancel(Cookie_);
+    Cookie_.reset();
+    Options_.CancellationToken.Unsubscribe(CancellationCookie_);
+    CancellationCookie_ = 0;
+}
+
+void TPeriodicExecutor::ScheduleAt(TClock::time_point deadline) {
+    std::lock_guard<std::mutex> lock(CookieMutex_);
+    // Checked under the lock so that a concurrent Stop either sees the new
+    // cookie or prevents it from being submitted.
+    if (StopFlag_.load(std::memory_order_relaxed)) return;
+
+    // The timer thread only hands the run over to the invoker.
+    Cookie_ = TDelayedExecutor::Get().Submit([this_ = TWeakPtr<TPeriodicExecutor>(this)] {
+        if (auto strong = this_.Lock()) {
+            strong->ScheduleNext();
+        }
+    }, deadline);
 }
 
 void TPeriodicExecutor::ScheduleNext() {
     if (StopFlag_.load(std::memory_order_relaxed)) return;
 
-    Invoker_->Run(Bind(&TPeriodicExecutor::Worker, TWeakPtr<TPeriodicExecutor>(this)));
+    Invoker_->Run(Options_.CancellationToken, Bind(&TPeriodicExecutor::Worker, TWeakPtr<TPeriodicExecutor>(this)))
+        .Subscribe([] (const TErrorOr<bool>& result) {
+            if (!result && result.Error().GetCode() != EErrorCode::Cancelled) {
+                LOG_ERROR("{}", result.Error().what());
+            }
+        });
 }
 
 void TPeriodicExecutor::Worker() {
@@ -47,8 +123,26 @@ void TPeriodicExecutor::Worker() {
         return;
     }
 
-    std::this_thread::sleep_for(Delay_);
-    ScheduleNext();
+    auto now = TClock::now();
+    if (Options_.Mode == EPeriodicMode::FixedRate && Options_.Period.count() > 0) {
+        NextDeadline_ += Options_.Period;
+        if (NextDeadline_ < now) {
+            auto missed = (now - NextDeadline_) / Options_.Period + 1;
+            NextDeadline_ += missed * Options_.Period;
+        }
+    } else {
+        NextDeadline_ = now + Options_.Period;
+    }
+
+    ScheduleAt(NextDeadline_ + GetJitter());
+}
+
+TPeriodicExecutor::TClock::duration TPeriodicExecutor::GetJitter() const {
+    if (Options_.Jitter <= 0.0) {
+        return TClock::duration::zero();
+    }
+    return std::chrono::duration_cast<TClock::duration>(
+        Options_.Period * Options_.Jitter * GetRandomShift());
 }
 
 ////////////////////////////////////////////////////////////////////////////////
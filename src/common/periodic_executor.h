@@ -1,11 +1,14 @@
 #pragma once
 
+#include <common/cancellation.h>
+#include <common/delayed_executor.h>
 #include <common/intrusive_ptr.h>
 #include <common/refcounted.h>
 
 #include <atomic>
 #include <chrono>
 #include <functional>
+#include <mutex>
 
 namespace NCommon {
 
@@ -13,6 +16,33 @@ namespace NCommon {
 
 class TInvoker;
 
+enum class EPeriodicMode {
+    // The next run starts Period after the previous one has finished.
+    FixedDelay,
+    // Runs are due at Start + k * Period; ticks missed by a slow callback are
+    // skipped rather than run back to back.
+    FixedRate,
+};
+
+struct TPeriodicExecutorOptions {
+    std::chrono::milliseconds Period{0};
+    EPeriodicMode Mode = EPeriodicMode::FixedDelay;
+
+    // The first run is delayed by a random amount in [0, Splay] so that
+    // executors started together do not fire together.
+    std::chrono::milliseconds Splay{0};
+
+    // Every run is shifted by a random amount within +-Jitter * Period. In the
+    // fixed-rate mode the shift does not accumulate.
+    double Jitter = 0.0;
+
+    // Cancelling the token stops the executor, including a run that is
+    // already queued on the invoker.
+    TCancellationToken CancellationToken;
+};
+
+// Calls |callback| on |invoker| until it returns true or Stop is called.
+// Between runs the executor only holds a TDelayedExecutor timer, not a worker.
 class TPeriodicExecutor : public NRefCounted::TRefCountedBase {
 public:
     TPeriodicExecutor(
@@ -21,21 +51,42 @@ public:
         std::chrono::milliseconds delay
     );
 
+    TPeriodicExecutor(
+        std::function<bool()> callback,
+        TIntrusivePtr<TInvoker> invoker,
+        TPeriodicExecutorOptions options
+    );
+
+    ~TPeriodicExecutor();
+
     void Start();
     void Stop();
 
 private:
+    using TClock = TDelayedExecutor::TClock;
+
+    void ScheduleAt(TClock::time_point deadline);
+
     void ScheduleNext();
 
     void Worker();
 
+    TClock::duration GetJitter() const;
+
     std::function<bool()> Callback_;
     TIntrusivePtr<TInvoker> Invoker_;
-    std::chrono::milliseconds Delay_;
+    const TPeriodicExecutorOptions Options_;
     std::atomic<bool> StopFlag_{false};
+
+    // Nominal deadline of the pending run; only touched by the run itself.
+    TClock::time_point NextDeadline_;
+
+    std::mutex CookieMutex_;
+    TDelayedExecutor::TCookie Cookie_;
+    TCancellationToken::TCookie CancellationCookie_ = 0;
 };
 
-DECLARE_REFCOUNTED(TPeriodicExecutor);
+DECLARE_POOLED_LONG_LIVED_REFCOUNTED(TPeriodicExecutor);
 
 ////////////////////////////////////////////////////////////////////////////////
 
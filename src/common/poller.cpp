@@ -0,0 +1,343 @@
+#include <common/logging.h>
+#include <common/poller.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+namespace NCommon {
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+// Set in TRegistration::State while a callback task is queued or running.
+constexpr uint32_t ScheduledBit = 1u << 31;
+
+uint32_t ToEpollEvents(EPollEvents events, ETriggerMode mode) {
+    uint32_t result = 0;
+    if (Any(events & EPollEvents::Read)) {
+        result |= EPOLLIN | EPOLLRDHUP;
+    }
+    if (Any(events & EPollEvents::Write)) {
+        result |= EPOLLOUT;
+    }
+    // Level-triggered descriptors are rearmed once their callback returns, so
+    // that a busy descriptor does not flood the invoker.
+    result |= mode == ETriggerMode::Edge ? EPOLLET : EPOLLONESHOT;
+    return result;
+}
+
+EPollEvents FromEpollEvents(uint32_t events) {
+    auto result = EPollEvents::None;
+    if (events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP)) {
+        result = result | EPollEvents::Read;
+    }
+    if (events & EPOLLOUT) {
+        result = result | EPollEvents::Write;
+    }
+    if (events & (EPOLLERR | EPOLLHUP)) {
+        result = result | EPollEvents::Error;
+    }
+    return result;
+}
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////
+
+void SetNonBlocking(int fd) {
+    int flags = fcntl(fd, F_GETFL);
+    if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0) {
+        THROW("Failed to make descriptor {} non-blocking: {}", fd, std::strerror(errno));
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+class TPoller::TRegistration
+    : public NRefCounted::TRefCountedBase
+{
+public:
+    int Fd = -1;
+    ETriggerMode Mode = ETriggerMode::Edge;
+    TThread* Thread = nullptr;
+    TIntrusivePtr<TInvoker> Invoker;
+    TCallback Callback;
+
+    // Pending EPollEvents plus ScheduledBit.
+    std::atomic<uint32_t> State{0};
+
+    // Guards Events and Closed against epoll_ctl calls: once Closed is set the
+    // descriptor is never rearmed, even if its number gets reused.
+    std::mutex ArmMutex;
+    EPollEvents Events = EPollEvents::None;
+    std::atomic<bool> Closed{false};
+
+    // One pin for the poller thread, dropped when the registration is
+    // retired, and one per callback task in flight.
+    std::atomic<size_t> Pins{1};
+    TPromise<void> Unregistered = NewPromise<void>();
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+TPoller::TPoller(TPollerOptions options)
+    : Options_(options)
+{
+    const size_t threadCount = std::max<size_t>(Options_.ThreadCount, 1);
+    for (size_t index = 0; index < threadCount; ++index) {
+        auto thread = std::make_unique<TThread>();
+        thread->EpollFd = epoll_create1(EPOLL_CLOEXEC);
+        thread->WakeupFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+        if (thread->EpollFd < 0 || thread->WakeupFd < 0) {
+            THROW("Failed to create poller: {}", std::strerror(errno));
+        }
+
+        // The wakeup descriptor is told apart by its null pointer.
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.ptr = nullptr;
+        if (epoll_ctl(thread->EpollFd, EPOLL_CTL_ADD, thread->WakeupFd, &event) < 0) {
+            THROW("Failed to register poller wakeup descriptor: {}", std::strerror(errno));
+        }
+        Threads_.push_back(std::move(thread));
+    }
+    for (auto& thread : Threads_) {
+        thread->Thread = std::thread(&TPoller::Loop, this, std::ref(*thread));
+    }
+}
+
+TPoller::~TPoller() {
+    Stop_.store(true, std::memory_order_release);
+    for (auto& thread : Threads_) {
+        Wakeup(*thread);
+    }
+    for (auto& thread : Threads_) {
+        if (thread->Thread.joinable()) {
+            thread->Thread.join();
+        }
+        close(thread->EpollFd);
+        close(thread->WakeupFd);
+    }
+
+    // Queued callback tasks hold the poller and Dispatch never queues one once
+    // the count has dropped to zero, so none is left; just make sure the
+    // registrations never touch the closed epoll descriptors.
+    for (auto& [fd, registration] : Registrations_) {
+        std::lock_guard<std::mutex> lock(registration->ArmMutex);
+        registration->Closed.store(true, std::memory_order_release);
+    }
+}
+
+void TPoller::Register(
+    int fd,
+    EPollEvents events,
+    TIntrusivePtr<TInvoker> invoker,
+    TCallback callback,
+    ETriggerMode mode)
+{
+    auto registration = New<TRegistration>();
+    registration->Fd = fd;
+    registration->Mode = mode;
+    registration->Thread = Threads_[fd % Threads_.size()].get();
+    registration->Invoker = std::move(invoker);
+    registration->Callback = std::move(callback);
+    registration->Events = events;
+
+    std::lock_guard<std::mutex> lock(Mutex_);
+    if (!Registrations_.emplace(fd, registration).second) {
+        THROW("Descriptor {} is already registered in the poller", fd);
+    }
+    try {
+        std::lock_guard<std::mutex> armLock(registration->ArmMutex);
+        Arm(*registration, EPOLL_CTL_ADD);
+    } catch (...) {
+        Registrations_.erase(fd);
+        throw;
+    }
+}
+
+void TPoller::Modify(int fd, EPollEvents events) {
+    TRegistrationPtr registration;
+    {
+        std::lock_guard<std::mutex> lock(Mutex_);
+        auto it = Registrations_.find(fd);
+        if (it == Registrations_.end()) {
+            THROW("Descriptor {} is not registered in the poller", fd);
+        }
+        registration = it->second;
+    }
+
+    std::lock_guard<std::mutex> lock(registration->ArmMutex);
+    if (!registration->Closed.load(std::memory_order_relaxed)) {
+        registration->Events = events;
+        Arm(*registration, EPOLL_CTL_MOD);
+    }
+}
+
+TFuture<void> TPoller::Unregister(int fd) {
+    TRegistrationPtr registration;
+    {
+        std::lock_guard<std::mutex> lock(Mutex_);
+        auto it = Registrations_.find(fd);
+        if (it == Registrations_.end()) {
+            return MakeFuture(TErrorOr<void>(TException(Format("Descriptor {} is not registered in the poller", fd))));
+        }
+        registration = std::move(it->second);
+        Registrations_.erase(it);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(registration->ArmMutex);
+        registration->Closed.store(true, std::memory_order_release);
+        // Fails harmlessly if the descriptor has already been closed.
+        epoll_ctl(registration->Thread->EpollFd, EPOLL_CTL_DEL, fd, nullptr);
+    }
+
+    auto future = registration->Unregistered.ToFuture();
+    auto* thread = registration->Thread;
+    {
+        std::lock_guard<std::mutex> lock(thread->RetiredMutex);
+        thread->Retired.push_back(std::move(registration));
+    }
+    Wakeup(*thread);
+    return future;
+}
+
+TFuture<EPollEvents> TPoller::WaitReady(int fd, EPollEvents events, TIntrusivePtr<TInvoker> invoker) {
+    auto promise = NewPromise<EPollEvents>();
+    // Callback tasks hold the poller, so a raw pointer is enough and keeps the
+    // registration from owning its poller.
+    try {
+        Register(fd, events, std::move(invoker), [this, fd, promise] (EPollEvents ready) {
+            // Deregistered first so that the continuation may close |fd|.
+            Unregister(fd);
+            promise.TrySet(ready);
+        }, ETriggerMode::Level);
+    } catch (std::exception& ex) {
+        return MakeFuture(TErrorOr<EPollEvents>(ex));
+    }
+    return promise.ToFuture();
+}
+
+void TPoller::Loop(TThread& thread) {
+    std::vector<epoll_event> events(std::max<size_t>(Options_.MaxEventsPerWait, 1));
+    while (!Stop_.load(std::memory_order_acquire)) {
+        int count = epoll_wait(thread.EpollFd, events.data(), events.size(), -1);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            LOG_ERROR("Poller wait failed: {}", std::strerror(errno));
+            return;
+        }
+
+        for (int index = 0; index < count; ++index) {
+            auto* registration = static_cast<TRegistration*>(events[index].data.ptr);
+            if (!registration) {
+                uint64_t value;
+                while (read(thread.WakeupFd, &value, sizeof(value)) > 0) {
+                }
+                continue;
+            }
+            Dispatch(registration, FromEpollEvents(events[index].events));
+        }
+
+        std::vector<TRegistrationPtr> retired;
+        {
+            std::lock_guard<std::mutex> lock(thread.RetiredMutex);
+            retired.swap(thread.Retired);
+        }
+        for (auto& registration : retired) {
+            Unpin(*registration);
+        }
+    }
+}
+
+void TPoller::Wakeup(TThread& thread) {
+    uint64_t value = 1;
+    // Only fails when the counter is about to overflow, which wakes up anyway.
+    [[maybe_unused]] auto written = write(thread.WakeupFd, &value, sizeof(value));
+}
+
+void TPoller::Dispatch(TRegistration* registration, EPollEvents events) {
+    if (registration->Closed.load(std::memory_order_acquire)) {
+        return;
+    }
+
+    // The last external reference may be gone while this thread is still
+    // working through an epoll batch; the destructor is then waiting to join
+    // it and the poller must not be revived.
+    if (!NRefCounted::TryRef(this)) {
+        return;
+    }
+    TPollerPtr poller(this);
+    NRefCounted::Unref(this);
+
+    auto previous = registration->State.fetch_or(static_cast<uint32_t>(events) | ScheduledBit, std::memory_order_acq_rel);
+    if (previous & ScheduledBit) {
+        return;
+    }
+
+    registration->Pins.fetch_add(1, std::memory_order_relaxed);
+    registration->Invoker->Invoke([poller = std::move(poller), registration = TRegistrationPtr(registration)] {
+        poller->RunCallbacks(registration);
+    });
+}
+
+void TPoller::RunCallbacks(const TRegistrationPtr& registration) {
+    while (true) {
+        auto state = registration->State.exchange(ScheduledBit, std::memory_order_acq_rel);
+        auto events = static_cast<EPollEvents>(state & ~ScheduledBit);
+        if (Any(events) && !registration->Closed.load(std::memory_order_acquire)) {
+            try {
+                registration->Callback(events);
+            } catch (const std::exception& ex) {
+                LOG_ERROR("Poller callback for descriptor {} failed: {}", registration->Fd, ex.what());
+            }
+        }
+
+        auto expected = ScheduledBit;
+        if (registration->State.compare_exchange_strong(expected, 0, std::memory_order_acq_rel)) {
+            break;
+        }
+    }
+
+    if (registration->Mode == ETriggerMode::Level) {
+        std::lock_guard<std::mutex> lock(registration->ArmMutex);
+        if (!registration->Closed.load(std::memory_order_relaxed)) {
+            try {
+                Arm(*registration, EPOLL_CTL_MOD);
+            } catch (const std::exception& ex) {
+                // Most likely closed without Unregister; nothing to rearm.
+                LOG_ERROR("{}", ex.what());
+            }
+        }
+    }
+    Unpin(*registration);
+}
+
+void TPoller::Arm(TRegistration& registration, int operation) {
+    epoll_event event{};
+    event.events = ToEpollEvents(registration.Events, registration.Mode);
+    event.data.ptr = &registration;
+    if (epoll_ctl(registration.Thread->EpollFd, operation, registration.Fd, &event) < 0) {
+        THROW("Failed to arm descriptor {} in the poller: {}", registration.Fd, std::strerror(errno));
+    }
+}
+
+void TPoller::Unpin(TRegistration& registration) {
+    if (registration.Pins.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        registration.Unregistered.TrySet(TErrorOr<void>());
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NCommon
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <common/future.h>
+#include <common/intrusive_ptr.h>
+#include <common/refcounted.h>
+#include <common/task.h>
+#include <common/threadpool.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace NCommon {
+
+////////////////////////////////////////////////////////////////////////////////
+
+enum class EPollEvents : uint32_t {
+    None = 0,
+    // Also reported on a hangup so that the reader sees the end of stream.
+    Read = 1 << 0,
+    Write = 1 << 1,
+    // Error or hangup; reported whether asked for or not.
+    Error = 1 << 2,
+};
+
+constexpr EPollEvents operator|(EPollEvents lhs, EPollEvents rhs) {
+    return static_cast<EPollEvents>(static_cast<uint32_t>(lhs) | static_cast<uint32_t>(rhs));
+}
+
+constexpr EPollEvents operator&(EPollEvents lhs, EPollEvents rhs) {
+    return static_cast<EPollEvents>(static_cast<uint32_t>(lhs) & static_cast<uint32_t>(rhs));
+}
+
+constexpr bool Any(EPollEvents events) {
+    return events != EPollEvents::None;
+}
+
+enum class ETriggerMode {
+    // The callback is called again as long as the descriptor stays ready; it
+    // may handle just part of the data.
+    Level,
+    // The callback is called once per readiness change and must read or write
+    // until EAGAIN.
+    Edge,
+};
+
+struct TPollerOptions {
+    // Poller threads, each with its own epoll instance; descriptors are
+    // spread over them by number.
+    size_t ThreadCount = 1;
+
+    // Events taken by a single epoll_wait.
+    size_t MaxEventsPerWait = 256;
+};
+
+// Switches |fd| to non-blocking mode, as pollers expect.
+void SetNonBlocking(int fd);
+
+// epoll reactor. Poller threads only collect readiness and hand it over to
+// the invoker a descriptor was registered with, so callbacks never run on a
+// poller thread. Callbacks of one descriptor never overlap: readiness that
+// arrives while one runs is merged into the next call. An eventfd wakes the
+// threads up for shutdown and deregistration.
+class TPoller
+    : public NRefCounted::TRefCountedBase
+{
+public:
+    using TCallback = TUniqueFunction<void(EPollEvents)>;
+
+    explicit TPoller(TPollerOptions options = {});
+
+    ~TPoller();
+
+    // Calls |callback| on |invoker| whenever |fd| becomes ready for |events|.
+    // A descriptor can be registered once at a time.
+    void Register(
+        int fd,
+        EPollEvents events,
+        TIntrusivePtr<TInvoker> invoker,
+        TCallback callback,
+        ETriggerMode mode = ETriggerMode::Edge);
+
+    // Replaces the events a registered descriptor is watched for.
+    void Modify(int fd, EPollEvents events);
+
+    // Resolves once no callback of |fd| runs or will run, after which the
+    // descriptor may be closed. Callbacks already queued are skipped.
+    TFuture<void> Unregister(int fd);
+
+    // Resolves on |invoker| the first time |fd| becomes ready for |events|;
+    // |fd| must not be registered meanwhile, or the future fails right away.
+    TFuture<EPollEvents> WaitReady(int fd, EPollEvents events, TIntrusivePtr<TInvoker> invoker);
+
+private:
+    class TRegistration;
+    using TRegistrationPtr = TIntrusivePtr<TRegistration>;
+
+    struct TThread {
+        int EpollFd = -1;
+        int WakeupFd = -1;
+        std::thread Thread;
+
+        // Unregistered descriptors whose events may still sit in the batch
+        // being processed; released after it.
+        std::mutex RetiredMutex;
+        std::vector<TRegistrationPtr> Retired;
+    };
+
+    void Loop(TThread& thread);
+    void Wakeup(TThread& thread);
+
+    void Dispatch(TRegistration* registration, EPollEvents events);
+    void RunCallbacks(const TRegistrationPtr& registration);
+    void Arm(TRegistration& registration, int operation);
+    void Unpin(TRegistration& registration);
+
+    const TPollerOptions Options_;
+    std::vector<std::unique_ptr<TThread>> Threads_;
+    std::atomic<bool> Stop_{false};
+
+    std::mutex Mutex_;
+    std::unordered_map<int, TRegistrationPtr> Registrations_;
+};
+
+DECLARE_REFCOUNTED(TPoller);
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NCommon
@@ -0,0 +1,283 @@
+#include <common/pool_allocator.h>
+#include <common/json.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <new>
+
+namespace NRefCounted {
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+// Blocks moved between a thread cache and the central pool at once.
+constexpr size_t BatchSize = 32;
+// A thread cache holding more free blocks of a class returns a batch.
+constexpr size_t MaxCachedBlocks = 2 * BatchSize;
+constexpr size_t SlabSize = 64 * 1024;
+
+struct TFreeBlock {
+    TFreeBlock* Next;
+};
+
+struct TBatch {
+    TFreeBlock* Head = nullptr;
+    size_t Count = 0;
+};
+
+size_t GetBlockSize(uint32_t sizeClass) {
+    return (sizeClass + 1) * PoolSizeClassStep;
+}
+
+struct TCentralPool {
+    std::mutex Mutex;
+    std::vector<TBatch> Batches;
+    std::vector<void*> Slabs;
+    size_t Blocks = 0;
+    size_t FreeBlocks = 0;
+    // Of exited threads and of calls made after the thread cache was gone.
+    uint64_t Allocations = 0;
+    uint64_t Deallocations = 0;
+};
+
+std::array<TCentralPool, PoolSizeClassCount>& GetCentralPools() {
+    // Leaked: objects with static storage duration may be freed after any
+    // static destructor has run.
+    static auto* pools = new std::array<TCentralPool, PoolSizeClassCount>();
+    return *pools;
+}
+
+// Splits a new slab into batches. Called under the pool lock.
+void Carve(TCentralPool& pool, uint32_t sizeClass) {
+    const size_t blockSize = GetBlockSize(sizeClass);
+    auto* slab = static_cast<char*>(::operator new(SlabSize, std::align_val_t(PoolBlockAlignment)));
+    pool.Slabs.push_back(slab);
+
+    const size_t blockCount = SlabSize / blockSize;
+    for (size_t first = 0; first < blockCount; first += BatchSize) {
+        TBatch batch;
+        for (size_t index = std::min(first + BatchSize, blockCount); index-- > first; ) {
+            auto* block = reinterpret_cast<TFreeBlock*>(slab + index * blockSize);
+            block->Next = batch.Head;
+            batch.Head = block;
+            ++batch.Count;
+        }
+        pool.Batches.push_back(batch);
+    }
+    pool.Blocks += blockCount;
+    pool.FreeBlocks += blockCount;
+}
+
+TBatch TakeBatch(uint32_t sizeClass) {
+    auto& pool = GetCentralPools()[sizeClass];
+    std::lock_guard<std::mutex> lock(pool.Mutex);
+    if (pool.Batches.empty()) {
+        Carve(pool, sizeClass);
+    }
+    auto batch = pool.Batches.back();
+    pool.Batches.pop_back();
+    pool.FreeBlocks -= batch.Count;
+    return batch;
+}
+
+void PutBatch(uint32_t sizeClass, TBatch batch) {
+    auto& pool = GetCentralPools()[sizeClass];
+    std::lock_guard<std::mutex> lock(pool.Mutex);
+    pool.FreeBlocks += batch.Count;
+    pool.Batches.push_back(batch);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+template <typename T>
+void Add(std::atomic<T>& counter, T delta = 1) {
+    counter.store(counter.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+}
+
+struct TSizeClassCache {
+    TFreeBlock* Head = nullptr;
+    // Written by the owning thread only; atomic so statistics can read them.
+    std::atomic<size_t> Count = 0;
+    std::atomic<uint64_t> Allocations = 0;
+    std::atomic<uint64_t> Deallocations = 0;
+};
+
+class TThreadCache {
+public:
+    TThreadCache();
+    ~TThreadCache();
+
+    std::array<TSizeClassCache, PoolSizeClassCount> Classes;
+};
+
+struct TThreadCacheRegistry {
+    std::mutex Mutex;
+    std::vector<TThreadCache*> Caches;
+};
+
+TThreadCacheRegistry& GetThreadCacheRegistry() {
+    static auto* registry = new TThreadCacheRegistry();
+    return *registry;
+}
+
+thread_local TThreadCache ThreadCache;
+thread_local bool ThreadCacheDestroyed = false;
+
+TThreadCache::TThreadCache() {
+    auto& registry = GetThreadCacheRegistry();
+    std::lock_guard<std::mutex> lock(registry.Mutex);
+    registry.Caches.push_back(this);
+}
+
+TThreadCache::~TThreadCache() {
+    ThreadCacheDestroyed = true;
+
+    auto& registry = GetThreadCacheRegistry();
+    std::lock_guard<std::mutex> lock(registry.Mutex);
+    registry.Caches.erase(std::find(registry.Caches.begin(), registry.Caches.end(), this));
+
+    // Under the registry lock, so a statistics snapshot sees the counters
+    // either here or in the central pool.
+    for (uint32_t sizeClass = 0; sizeClass < PoolSizeClassCount; ++sizeClass) {
+        auto& cache = Classes[sizeClass];
+        auto& pool = GetCentralPools()[sizeClass];
+        std::lock_guard<std::mutex> poolLock(pool.Mutex);
+        pool.Allocations += cache.Allocations.load(std::memory_order_relaxed);
+        pool.Deallocations += cache.Deallocations.load(std::memory_order_relaxed);
+        if (cache.Head) {
+            TBatch batch{cache.Head, cache.Count.load(std::memory_order_relaxed)};
+            pool.FreeBlocks += batch.Count;
+            pool.Batches.push_back(batch);
+        }
+    }
+}
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////
+
+void* AllocatePooled(uint32_t sizeClass) {
+    if (ThreadCacheDestroyed) {
+        auto batch = TakeBatch(sizeClass);
+        auto* block = batch.Head;
+        batch.Head = block->Next;
+        --batch.Count;
+
+        auto& pool = GetCentralPools()[sizeClass];
+        std::lock_guard<std::mutex> lock(pool.Mutex);
+        ++pool.Allocations;
+        if (batch.Head) {
+            pool.FreeBlocks += batch.Count;
+            pool.Batches.push_back(batch);
+        }
+        return block;
+    }
+
+    auto& cache = ThreadCache.Classes[sizeClass];
+    if (!cache.Head) {
+        auto batch = TakeBatch(sizeClass);
+        cache.Head = batch.Head;
+        cache.Count.store(batch.Count, std::memory_order_relaxed);
+    }
+
+    auto* block = cache.Head;
+    cache.Head = block->Next;
+    Add(cache.Count, static_cast<size_t>(-1));
+    Add(cache.Allocations);
+    return block;
+}
+
+void FreePooled(void* ptr, uint32_t sizeClass) noexcept {
+    auto* block = static_cast<TFreeBlock*>(ptr);
+    if (ThreadCacheDestroyed) {
+        auto& pool = GetCentralPools()[sizeClass];
+        std::lock_guard<std::mutex> lock(pool.Mutex);
+        ++pool.Deallocations;
+        ++pool.FreeBlocks;
+        block->Next = nullptr;
+        pool.Batches.push_back({block, 1});
+        return;
+    }
+
+    auto& cache = ThreadCache.Classes[sizeClass];
+    block->Next = cache.Head;
+    cache.Head = block;
+    Add(cache.Count);
+    Add(cache.Deallocations);
+
+    if (cache.Count.load(std::memory_order_relaxed) > MaxCachedBlocks) {
+        TBatch batch{cache.Head, BatchSize};
+        auto* last = cache.Head;
+        for (size_t index = 1; index < BatchSize; ++index) {
+            last = last->Next;
+        }
+        cache.Head = last->Next;
+        last->Next = nullptr;
+        Add(cache.Count, -BatchSize);
+        PutBatch(sizeClass, batch);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+size_t TPoolSizeClassStatistics::GetUsedBlocks() const {
+    return Blocks - CentralFreeBlocks - CachedFreeBlocks;
+}
+
+NJson::TJsonNode TPoolStatistics::ToJson() const {
+    NJson::TJsonNode result;
+    result["slab_bytes"] = SlabBytes;
+
+    NJson::TJsonNode sizeClasses = std::vector<NJson::TJsonNode>();
+    for (const auto& statistics : SizeClasses) {
+        NJson::TJsonNode node;
+        node["block_size"] = statistics.BlockSize;
+        node["allocations"] = statistics.Allocations;
+        node["deallocations"] = statistics.Deallocations;
+        node["blocks"] = statistics.Blocks;
+        node["used_blocks"] = statistics.GetUsedBlocks();
+        node["central_free_blocks"] = statistics.CentralFreeBlocks;
+        node["cached_free_blocks"] = statistics.CachedFreeBlocks;
+        sizeClasses.push_back(std::move(node));
+    }
+    result["size_classes"] = std::move(sizeClasses);
+    return result;
+}
+
+TPoolStatistics GetPoolStatistics() {
+    TPoolStatistics result;
+
+    auto& registry = GetThreadCacheRegistry();
+    std::lock_guard<std::mutex> lock(registry.Mutex);
+    for (uint32_t sizeClass = 0; sizeClass < PoolSizeClassCount; ++sizeClass) {
+        TPoolSizeClassStatistics statistics;
+        statistics.BlockSize = GetBlockSize(sizeClass);
+        {
+            auto& pool = GetCentralPools()[sizeClass];
+            std::lock_guard<std::mutex> poolLock(pool.Mutex);
+            statistics.Allocations = pool.Allocations;
+            statistics.Deallocations = pool.Deallocations;
+            statistics.Blocks = pool.Blocks;
+            statistics.CentralFreeBlocks = pool.FreeBlocks;
+            result.SlabBytes += pool.Slabs.size() * SlabSize;
+        }
+        if (statistics.Blocks == 0) {
+            continue;
+        }
+        for (const auto* cache : registry.Caches) {
+            const auto& classCache = cache->Classes[sizeClass];
+            statistics.Allocations += classCache.Allocations.load(std::memory_order_relaxed);
+            statistics.Deallocations += classCache.Deallocations.load(std::memory_order_relaxed);
+            statistics.CachedFreeBlocks += classCache.Count.load(std::memory_order_relaxed);
+        }
+        result.SizeClasses.push_back(statistics);
+    }
+    return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NRefCounted
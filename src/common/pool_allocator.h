@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace NJson {
+
+class TJsonNode;
+
+} // namespace NJson
+
+namespace NRefCounted {
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Blocks of pooled refcounted objects come in size classes of
+// PoolSizeClassStep bytes. Each thread caches free blocks per class and trades
+// them with a central pool in batches, so most New<T>/Unref pairs touch no
+// shared state. Memory is carved from slabs that are kept for reuse and never
+// returned to the system.
+constexpr size_t PoolSizeClassStep = 16;
+constexpr size_t PoolSizeClassCount = 64;
+constexpr size_t MaxPooledBlockSize = PoolSizeClassStep * PoolSizeClassCount;
+
+// Blocks start at this alignment; types that need more are not pooled.
+constexpr size_t PoolBlockAlignment = PoolSizeClassStep;
+
+// Size class tag of blocks too large or overaligned for the pools.
+constexpr uint32_t UnpooledSizeClass = PoolSizeClassCount;
+
+// Size class tag of blocks carved from a TArena (arena.h).
+constexpr uint32_t ArenaSizeClass = PoolSizeClassCount + 1;
+
+constexpr uint32_t GetPoolSizeClass(size_t size) {
+    return size > MaxPooledBlockSize
+        ? UnpooledSizeClass
+        : static_cast<uint32_t>((size + PoolSizeClassStep - 1) / PoolSizeClassStep - 1);
+}
+
+void* AllocatePooled(uint32_t sizeClass);
+void FreePooled(void* ptr, uint32_t sizeClass) noexcept;
+
+// Implemented in arena.cpp. Returns null outside of a TArenaScope or if the
+// block does not fit into an arena chunk; otherwise the block holds a
+// reference to the arena until freed.
+void* AllocateFromCurrentArena(size_t size, size_t alignment);
+void FreeToArena(void* ptr) noexcept;
+
+////////////////////////////////////////////////////////////////////////////////
+
+struct TPoolSizeClassStatistics {
+    size_t BlockSize = 0;
+    uint64_t Allocations = 0;
+    uint64_t Deallocations = 0;
+    // Blocks carved from slabs so far.
+    size_t Blocks = 0;
+    // Free blocks held by the central pool and by thread caches; the rest of
+    // Blocks is in use.
+    size_t CentralFreeBlocks = 0;
+    size_t CachedFreeBlocks = 0;
+
+    size_t GetUsedBlocks() const;
+};
+
+struct TPoolStatistics {
+    // Only size classes that have been allocated from.
+    std::vector<TPoolSizeClassStatistics> SizeClasses;
+    size_t SlabBytes = 0;
+
+    NJson::TJsonNode ToJson() const;
+};
+
+// Counters of live threads are read without stopping them, so the snapshot is
+// approximate while allocations are in flight.
+TPoolStatistics GetPoolStatistics();
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NRefCounted
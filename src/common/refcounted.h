@@ -1,10 +1,13 @@
 #pragma once
 
 #include <common/logging.h>
+#include <common/pool_allocator.h>
 
 #include <cstdlib>
+#include <cstring>
 #include <new>
 #include <atomic>
+#include <type_traits>
 
 namespace NRefCounted {
 
@@ -51,6 +54,33 @@ class TIntrusivePtr;
 #define DECLARE_REFCOUNTED(type) \
     using type ## Ptr = ::NCommon::TIntrusivePtr<type>;
 
+// Like DECLARE_REFCOUNTED, and New<type> takes its block from the size-class
+// pools of pool_allocator.h, or from the current TArena, instead of
+// std::aligned_alloc. For class
+// templates declare the EnablePooledAllocation overload by hand. Types derived
+// from a pooled type are pooled as well.
+#define DECLARE_POOLED_REFCOUNTED(type) \
+    DECLARE_REFCOUNTED(type) \
+    inline std::true_type EnablePooledAllocation(type*) { return {}; }
+
+// Like DECLARE_POOLED_REFCOUNTED, but never placed in a TArena. For types
+// that usually outlive the request creating them, such as invokers and
+// executors: one of them in an arena would keep all its chunks alive.
+#define DECLARE_POOLED_LONG_LIVED_REFCOUNTED(type) \
+    DECLARE_POOLED_REFCOUNTED(type) \
+    inline std::true_type DisableArenaAllocation(type*) { return {}; }
+
+// Found by argument-dependent lookup, so the overload lives next to the type.
+template <typename T>
+concept PooledRefCounted = requires (T* ptr) {
+    { EnablePooledAllocation(ptr) } -> std::same_as<std::true_type>;
+};
+
+template <typename T>
+concept ArenaRefCounted = PooledRefCounted<T> && !requires (T* ptr) {
+    { DisableArenaAllocation(ptr) } -> std::same_as<std::true_type>;
+};
+
 ////////////////////////////////////////////////////////////////////////////////
 
 template <typename T>
@@ -61,21 +91,57 @@ private:
     static constexpr size_t RefCounterOffset_ = (RefCounterSize_ + Align_ - 1) / Align_ * Align_;
     static constexpr size_t TotalAllocSize_ = RefCounterOffset_ + sizeof(T);
 
+    // Pooled blocks keep their size class right before the ref counter, so a
+    // block freed through a base type still goes back to its own class. Inside
+    // a TArenaScope they are carved from the arena instead.
+    static constexpr bool Pooled_ = PooledRefCounted<T>;
+    static constexpr bool InArena_ = ArenaRefCounted<T>;
+    static constexpr size_t PoolPrefixSize_ = Pooled_ ? Align_ : 0;
+    static constexpr uint32_t SizeClass_ = Align_ <= PoolBlockAlignment
+        ? GetPoolSizeClass(PoolPrefixSize_ + TotalAllocSize_)
+        : UnpooledSizeClass;
+
 public:
     static T* Allocate() {
-        const size_t aligned_size = (TotalAllocSize_ + Align_ - 1) / Align_ * Align_;
-        void* ptr = std::aligned_alloc(Align_, aligned_size);
-        if (!ptr) {
-            throw std::bad_alloc();
+        void* ptr = nullptr;
+        if constexpr (Pooled_) {
+            uint32_t sizeClass = ArenaSizeClass;
+            void* block = nullptr;
+            if constexpr (InArena_) {
+                block = AllocateFromCurrentArena(PoolPrefixSize_ + TotalAllocSize_, Align_);
+            }
+            if (!block) {
+                sizeClass = SizeClass_;
+                block = SizeClass_ == UnpooledSizeClass
+                    ? AllocateAligned(PoolPrefixSize_ + TotalAllocSize_)
+                    : AllocatePooled(SizeClass_);
+            }
+            ptr = static_cast<char*>(block) + PoolPrefixSize_;
+            std::memcpy(static_cast<char*>(ptr) - sizeof(sizeClass), &sizeClass, sizeof(sizeClass));
+        } else {
+            ptr = AllocateAligned(TotalAllocSize_);
         }
-        
+
         new (ptr) TRefCounter();
         T* objectPtr = reinterpret_cast<T*>(static_cast<char*>(ptr) + RefCounterOffset_);
         return objectPtr;
     }
 
     static void Deallocate(void* ptr) {
-        std::free(static_cast<char*>(ptr) - RefCounterOffset_);
+        char* counterPtr = static_cast<char*>(ptr) - RefCounterOffset_;
+        if constexpr (Pooled_) {
+            uint32_t sizeClass;
+            std::memcpy(&sizeClass, counterPtr - sizeof(sizeClass), sizeof(sizeClass));
+            if (sizeClass == ArenaSizeClass) {
+                FreeToArena(counterPtr - PoolPrefixSize_);
+                return;
+            }
+            if (sizeClass != UnpooledSizeClass) {
+                FreePooled(counterPtr - PoolPrefixSize_, sizeClass);
+                return;
+            }
+        }
+        std::free(counterPtr - PoolPrefixSize_);
     }
 
     template <typename... Args>
@@ -94,6 +160,16 @@ public:
     static TRefCounter* GetRefCounter(void* ptr) {
         return reinterpret_cast<TRefCounter*>(static_cast<char*>(ptr) - RefCounterOffset_);
     }
+
+private:
+    static void* AllocateAligned(size_t size) {
+        const size_t aligned_size = (size + Align_ - 1) / Align_ * Align_;
+        void* ptr = std::aligned_alloc(Align_, aligned_size);
+        if (!ptr) {
+            throw std::bad_alloc();
+        }
+        return ptr;
+    }
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -115,6 +191,17 @@ inline bool TryRef(T* obj) {
     return TRefCountedHelper<T>::GetRefCounter(obj)->TryRef();
 }
 
+// True if the caller holds the only strong reference; the writes of the
+// holders that dropped theirs are visible then.
+template <class T>
+inline bool IsUnique(T* obj) {
+    if (TRefCountedHelper<T>::GetRefCounter(obj)->GetRefCount() != 1) {
+        return false;
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return true;
+}
+
 template <class T>
 inline void WeakRef(T* obj) {
     TRefCountedHelper<T>::GetRefCounter(obj)->WeakRef();
@@ -0,0 +1,134 @@
+#include <common/pool_allocator.h>
+#include <common/serialized_invoker.h>
+
+#include <algorithm>
+#include <thread>
+
+namespace NCommon {
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+thread_local const TSerializedInvoker* CurrentSerializedInvoker = nullptr;
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////
+
+void* TSerializedInvoker::TNode::operator new(size_t size) {
+    static_assert(alignof(TNode) <= NRefCounted::PoolBlockAlignment);
+    static_assert(sizeof(TNode) <= NRefCounted::MaxPooledBlockSize);
+    return NRefCounted::AllocatePooled(NRefCounted::GetPoolSizeClass(size));
+}
+
+void TSerializedInvoker::TNode::operator delete(void* ptr, size_t size) {
+    NRefCounted::FreePooled(ptr, NRefCounted::GetPoolSizeClass(size));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+TSerializedInvoker::TSerializedInvoker(TIntrusivePtr<TInvoker> underlying, size_t maxTasksPerDrain)
+    : TInvoker(underlying->GetThreadPool(), underlying->GetPriority())
+    , Underlying_(std::move(underlying))
+    , MaxTasksPerDrain_(std::max<size_t>(maxTasksPerDrain, 1))
+    , Head_(&Stub_)
+    , Tail_(&Stub_)
+{}
+
+TSerializedInvoker::~TSerializedInvoker() {
+    // A pending drain holds a reference, so the queue is empty here.
+    while (auto* node = TryPop()) {
+        delete node;
+    }
+}
+
+void TSerializedInvoker::Invoke(TTask task) {
+    auto* node = new TNode(std::move(task));
+    Push(node);
+    if (Pending_.fetch_add(1, std::memory_order_acq_rel) == 0) {
+        ScheduleDrain();
+    }
+}
+
+void TSerializedInvoker::Invoke(TTask task, const TSubmitOptions& /*options*/) {
+    Invoke(std::move(task));
+}
+
+bool TSerializedInvoker::IsCurrent() const {
+    return CurrentSerializedInvoker == this;
+}
+
+void TSerializedInvoker::Push(TNodeBase* node) {
+    node->Next.store(nullptr, std::memory_order_relaxed);
+    auto* prev = Head_.exchange(node, std::memory_order_acq_rel);
+    prev->Next.store(node, std::memory_order_release);
+}
+
+TSerializedInvoker::TNode* TSerializedInvoker::TryPop() {
+    auto* tail = Tail_;
+    auto* next = tail->Next.load(std::memory_order_acquire);
+    if (tail == &Stub_) {
+        if (!next) {
+            return nullptr;
+        }
+        Tail_ = next;
+        tail = next;
+        next = next->Next.load(std::memory_order_acquire);
+    }
+    if (next) {
+        Tail_ = next;
+        return static_cast<TNode*>(tail);
+    }
+    if (tail != Head_.load(std::memory_order_acquire)) {
+        return nullptr;
+    }
+    // |tail| is the last node: put the stub behind it so it can be handed out.
+    Push(&Stub_);
+    next = tail->Next.load(std::memory_order_acquire);
+    if (next) {
+        Tail_ = next;
+        return static_cast<TNode*>(tail);
+    }
+    return nullptr;
+}
+
+void TSerializedInvoker::ScheduleDrain() {
+    Underlying_->Invoke([this_ = TIntrusivePtr<TSerializedInvoker>(this)] {
+        this_->Drain();
+    });
+}
+
+void TSerializedInvoker::Drain() {
+    auto* previous = CurrentSerializedInvoker;
+    CurrentSerializedInvoker = this;
+
+    size_t executed = 0;
+    while (executed < MaxTasksPerDrain_) {
+        auto* node = TryPop();
+        if (!node) {
+            if (executed == Pending_.load(std::memory_order_acquire)) {
+                break;
+            }
+            // Counted but not linked in yet: the producer is between the two
+            // stores of Push.
+            std::this_thread::yield();
+            continue;
+        }
+
+        auto task = std::move(node->Task);
+        delete node;
+        task();
+        ++executed;
+    }
+
+    CurrentSerializedInvoker = previous;
+
+    if (Pending_.fetch_sub(executed, std::memory_order_acq_rel) != executed) {
+        ScheduleDrain();
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NCommon
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <common/task.h>
+#include <common/threadpool.h>
+
+#include <atomic>
+#include <cstddef>
+
+namespace NCommon {
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Strand on top of another invoker: callbacks run one at a time and in
+// submission order, so state touched only from here needs no mutex.
+//
+// Submissions go to an intrusive lock-free MPSC queue. The submitter that
+// makes the queue non-empty schedules a drain task on the underlying invoker;
+// a drain runs at most |maxTasksPerDrain| callbacks and then reschedules
+// itself, letting other work on the pool through.
+class TSerializedInvoker
+    : public TInvoker
+{
+public:
+    explicit TSerializedInvoker(TIntrusivePtr<TInvoker> underlying, size_t maxTasksPerDrain = 64);
+
+    ~TSerializedInvoker();
+
+    void Invoke(TTask task) override;
+
+    // Callbacks keep submission order and are never shed, so |options| are
+    // ignored.
+    void Invoke(TTask task, const TSubmitOptions& options) override;
+
+    // True while a callback of this invoker is running on the current thread.
+    bool IsCurrent() const;
+
+    const TIntrusivePtr<TInvoker>& GetUnderlying() const {
+        return Underlying_;
+    }
+
+private:
+    struct TNodeBase {
+        std::atomic<TNodeBase*> Next{nullptr};
+    };
+
+    struct TNode
+        : public TNodeBase
+    {
+        explicit TNode(TTask task)
+            : Task(std::move(task))
+        {}
+
+        // One node comes and goes with every callback, so nodes are taken
+        // from the size-class pools of pool_allocator.h.
+        static void* operator new(size_t size);
+        static void operator delete(void* ptr, size_t size);
+
+        TTask Task;
+    };
+
+    void Push(TNodeBase* node);
+    // Returns null if the queue is empty or a push is still being linked in.
+    TNode* TryPop();
+
+    void ScheduleDrain();
+    void Drain();
+
+    const TIntrusivePtr<TInvoker> Underlying_;
+    const size_t MaxTasksPerDrain_;
+
+    // Producers swap themselves into Head_; the single consumer walks from
+    // Tail_. Stub_ keeps the list non-empty; it carries no task so that the
+    // invoker keeps TInvoker's alignment.
+    std::atomic<TNodeBase*> Head_;
+    TNodeBase* Tail_;
+    TNodeBase Stub_;
+
+    // Submitted but not yet executed callbacks; the 0 -> 1 transition owns
+    // scheduling the drain.
+    std::atomic<size_t> Pending_{0};
+};
+
+DECLARE_REFCOUNTED(TSerializedInvoker);
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NCommon
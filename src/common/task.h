@@ -0,0 +1,133 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace NCommon {
+
+////////////////////////////////////////////////////////////////////////////////
+
+template <typename Signature, size_t InlineCapacity = 96>
+class TUniqueFunction;
+
+// Move-only replacement for std::function. Callables that fit into the inline
+// buffer and are nothrow-movable are stored in place, everything else falls
+// back to the heap.
+template <typename R, typename... Args, size_t InlineCapacity>
+class TUniqueFunction<R(Args...), InlineCapacity> {
+public:
+    TUniqueFunction() noexcept = default;
+
+    TUniqueFunction(std::nullptr_t) noexcept
+    {}
+
+    template <typename F>
+    requires(
+        !std::is_same_v<std::decay_t<F>, TUniqueFunction> &&
+        std::is_invocable_r_v<R, std::decay_t<F>&, Args...>)
+    TUniqueFunction(F&& f) {
+        using TFunctor = std::decay_t<F>;
+        if constexpr (IsInlined<TFunctor>) {
+            new (Storage_) TFunctor(std::forward<F>(f));
+            VTable_ = &InlineVTable<TFunctor>;
+        } else {
+            *reinterpret_cast<TFunctor**>(Storage_) = new TFunctor(std::forward<F>(f));
+            VTable_ = &HeapVTable<TFunctor>;
+        }
+    }
+
+    TUniqueFunction(TUniqueFunction&& other) noexcept {
+        MoveFrom(other);
+    }
+
+    TUniqueFunction& operator=(TUniqueFunction&& other) noexcept {
+        if (this != &other) {
+            Reset();
+            MoveFrom(other);
+        }
+        return *this;
+    }
+
+    TUniqueFunction(const TUniqueFunction&) = delete;
+    TUniqueFunction& operator=(const TUniqueFunction&) = delete;
+
+    ~TUniqueFunction() {
+        Reset();
+    }
+
+    R operator()(Args... args) {
+        return VTable_->Invoke(Storage_, std::forward<Args>(args)...);
+    }
+
+    explicit operator bool() const noexcept {
+        return VTable_ != nullptr;
+    }
+
+    void Reset() noexcept {
+        if (VTable_) {
+            VTable_->Destroy(Storage_);
+            VTable_ = nullptr;
+        }
+    }
+
+    // Whether a callable of type F is stored without a heap allocation.
+    template <typename F>
+    static constexpr bool IsInlined =
+        sizeof(F) <= InlineCapacity &&
+        alignof(F) <= alignof(std::max_align_t) &&
+        std::is_nothrow_move_constructible_v<F>;
+
+private:
+    struct TVTable {
+        R (*Invoke)(void* storage, Args&&... args);
+        void (*Relocate)(void* to, void* from) noexcept;
+        void (*Destroy)(void* storage) noexcept;
+    };
+
+    template <typename F>
+    static constexpr TVTable InlineVTable = {
+        [] (void* storage, Args&&... args) -> R {
+            return std::invoke(*std::launder(static_cast<F*>(storage)), std::forward<Args>(args)...);
+        },
+        [] (void* to, void* from) noexcept {
+            F* source = std::launder(static_cast<F*>(from));
+            new (to) F(std::move(*source));
+            source->~F();
+        },
+        [] (void* storage) noexcept {
+            std::launder(static_cast<F*>(storage))->~F();
+        },
+    };
+
+    template <typename F>
+    static constexpr TVTable HeapVTable = {
+        [] (void* storage, Args&&... args) -> R {
+            return std::invoke(**static_cast<F**>(storage), std::forward<Args>(args)...);
+        },
+        [] (void* to, void* from) noexcept {
+            *static_cast<F**>(to) = *static_cast<F**>(from);
+        },
+        [] (void* storage) noexcept {
+            delete *static_cast<F**>(storage);
+        },
+    };
+
+    void MoveFrom(TUniqueFunction& other) noexcept {
+        if (other.VTable_) {
+            other.VTable_->Relocate(Storage_, other.Storage_);
+            VTable_ = std::exchange(other.VTable_, nullptr);
+        }
+    }
+
+    alignas(std::max_align_t) unsigned char Storage_[InlineCapacity];
+    const TVTable* VTable_ = nullptr;
+};
+
+using TTask = TUniqueFunction<void()>;
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NCommon
@@ -0,0 +1,252 @@
+#include <common/task_graph.h>
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+namespace NCommon {
+
+////////////////////////////////////////////////////////////////////////////////
+
+// State of one run. Every node reaches a final state exactly once: either
+// from the thread that finished it or, for skipped nodes, from the thread
+// that released its last predecessor.
+class TTaskGraph::TExecution
+    : public NRefCounted::TRefCountedBase
+{
+public:
+    TExecution(TTaskGraphPtr graph, TIntrusivePtr<TInvoker> invoker)
+        : Graph_(std::move(graph))
+        , Invoker_(std::move(invoker))
+        , PendingPredecessors_(std::make_unique<std::atomic<size_t>[]>(Graph_->Nodes_.size()))
+        , UpstreamFailed_(std::make_unique<std::atomic<bool>[]>(Graph_->Nodes_.size()))
+        , Remaining_(Graph_->Nodes_.size())
+        , Promise_(NewPromise<void>())
+    {
+        for (size_t node = 0; node < Graph_->Nodes_.size(); ++node) {
+            PendingPredecessors_[node].store(Graph_->Nodes_[node].PredecessorCount, std::memory_order_relaxed);
+            UpstreamFailed_[node].store(false, std::memory_order_relaxed);
+        }
+    }
+
+    TFuture<void> Start() {
+        auto future = Promise_.ToFuture();
+        for (auto root : Graph_->Roots_) {
+            Schedule(root);
+        }
+        return future;
+    }
+
+private:
+    void Schedule(TNodeId node) {
+        Invoker_->Invoke([this_ = TIntrusivePtr<TExecution>(this), node] {
+            this_->Execute(node);
+        });
+    }
+
+    void Execute(TNodeId node) {
+        while (true) {
+            TFuture<void> future;
+            try {
+                future = Graph_->Nodes_[node].Body();
+            } catch (const std::exception& ex) {
+                future = MakeFuture(TErrorOr<void>(ex));
+            }
+
+            if (auto result = future.TryGet()) {
+                auto next = Complete(node, *result);
+                if (!next) {
+                    return;
+                }
+                // Continue the critical path on a warm cache.
+                node = *next;
+                continue;
+            }
+
+            future.Subscribe([this_ = TIntrusivePtr<TExecution>(this), node] (const TErrorOr<void>& result) {
+                if (auto next = this_->Complete(node, result)) {
+                    this_->Schedule(*next);
+                }
+            });
+            return;
+        }
+    }
+
+    // Records the outcome of |node| and releases its successors; the first
+    // one that becomes ready is returned for the caller to run, the others are
+    // scheduled.
+    std::optional<TNodeId> Complete(TNodeId node, const TErrorOr<void>& result) {
+        if (result) {
+            Graph_->States_[node] = ETaskGraphNodeState::Succeeded;
+        } else {
+            Graph_->States_[node] = ETaskGraphNodeState::Failed;
+            std::lock_guard<std::mutex> lock(ErrorMutex_);
+            if (!Error_) {
+                Error_ = result.Error();
+            }
+        }
+
+        std::optional<TNodeId> next;
+        size_t finished = 1;
+        // Skipped nodes release their own successors; a stack instead of
+        // recursion keeps long chains off the call stack.
+        std::vector<std::pair<TNodeId, bool>> released{{node, !result}};
+        while (!released.empty()) {
+            auto [from, failed] = released.back();
+            released.pop_back();
+
+            for (auto successor : Graph_->Nodes_[from].Successors) {
+                if (failed) {
+                    UpstreamFailed_[successor].store(true, std::memory_order_relaxed);
+                }
+                if (PendingPredecessors_[successor].fetch_sub(1, std::memory_order_acq_rel) != 1) {
+                    continue;
+                }
+
+                if (UpstreamFailed_[successor].load(std::memory_order_relaxed)) {
+                    Graph_->States_[successor] = ETaskGraphNodeState::Skipped;
+                    ++finished;
+                    released.emplace_back(successor, true);
+                } else if (!next) {
+                    next = successor;
+                } else {
+                    Schedule(successor);
+                }
+            }
+        }
+
+        if (Remaining_.fetch_sub(finished, std::memory_order_acq_rel) == finished) {
+            Finish();
+        }
+        return next;
+    }
+
+    void Finish() {
+        std::optional<TException> error;
+        {
+            std::lock_guard<std::mutex> lock(ErrorMutex_);
+            error = std::move(Error_);
+        }
+        // Nothing is scheduled any more. Dropped before the future resolves so
+        // that a worker never ends up holding the last reference to its pool.
+        Invoker_.reset();
+        // Lets a continuation of the future start the next run.
+        Graph_->Running_.store(false, std::memory_order_release);
+        if (error) {
+            Promise_.Set(TErrorOr<void>(*error));
+        } else {
+            Promise_.Set(TErrorOr<void>());
+        }
+    }
+
+    const TTaskGraphPtr Graph_;
+    TIntrusivePtr<TInvoker> Invoker_;
+
+    std::unique_ptr<std::atomic<size_t>[]> PendingPredecessors_;
+    // Set before the decrement that may make the node ready.
+    std::unique_ptr<std::atomic<bool>[]> UpstreamFailed_;
+    std::atomic<size_t> Remaining_;
+
+    std::mutex ErrorMutex_;
+    std::optional<TException> Error_;
+    TPromise<void> Promise_;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+TTaskGraph::TNodeId TTaskGraph::DoAddNode(TUniqueFunction<TFuture<void>()> body, double cost) {
+    ASSERT(!Running_.load(std::memory_order_acquire), "Cannot add nodes to a running task graph");
+
+    TNode node;
+    node.Body = std::move(body);
+    node.Cost = cost;
+    Nodes_.push_back(std::move(node));
+    States_.push_back(ETaskGraphNodeState::Pending);
+    return Nodes_.size() - 1;
+}
+
+void TTaskGraph::AddEdge(TNodeId from, TNodeId to) {
+    ASSERT(!Running_.load(std::memory_order_acquire), "Cannot add edges to a running task graph");
+    ASSERT(from < Nodes_.size() && to < Nodes_.size(), "Unknown task graph node {} or {}", from, to);
+    ASSERT(from != to, "Task graph node {} cannot depend on itself", from);
+
+    Nodes_[from].Successors.push_back(to);
+    ++Nodes_[to].PredecessorCount;
+}
+
+size_t TTaskGraph::GetNodeCount() const {
+    return Nodes_.size();
+}
+
+TFuture<void> TTaskGraph::Run(TIntrusivePtr<TInvoker> invoker) {
+    if (Running_.exchange(true, std::memory_order_acq_rel)) {
+        return MakeFuture(TErrorOr<void>(TException("Task graph is already running")));
+    }
+    if (!Prepare()) {
+        Running_.store(false, std::memory_order_release);
+        return MakeFuture(TErrorOr<void>(TException("Task graph has a cycle")));
+    }
+    std::fill(States_.begin(), States_.end(), ETaskGraphNodeState::Pending);
+    if (Nodes_.empty()) {
+        Running_.store(false, std::memory_order_release);
+        return MakeFuture();
+    }
+
+    auto execution = New<TExecution>(TTaskGraphPtr(this), std::move(invoker));
+    return execution->Start();
+}
+
+ETaskGraphNodeState TTaskGraph::GetNodeState(TNodeId node) const {
+    return States_[node];
+}
+
+bool TTaskGraph::Prepare() {
+    // Kahn's algorithm; ranks are then filled in reverse topological order.
+    std::vector<size_t> inDegree(Nodes_.size());
+    std::vector<TNodeId> order;
+    order.reserve(Nodes_.size());
+    for (TNodeId node = 0; node < Nodes_.size(); ++node) {
+        inDegree[node] = Nodes_[node].PredecessorCount;
+        if (inDegree[node] == 0) {
+            order.push_back(node);
+        }
+    }
+    for (size_t index = 0; index < order.size(); ++index) {
+        for (auto successor : Nodes_[order[index]].Successors) {
+            if (--inDegree[successor] == 0) {
+                order.push_back(successor);
+            }
+        }
+    }
+    if (order.size() != Nodes_.size()) {
+        return false;
+    }
+
+    for (auto it = order.rbegin(); it != order.rend(); ++it) {
+        auto& node = Nodes_[*it];
+        double longest = 0.0;
+        for (auto successor : node.Successors) {
+            longest = std::max(longest, Nodes_[successor].Rank);
+        }
+        node.Rank = node.Cost + longest;
+    }
+
+    auto byRank = [this] (TNodeId lhs, TNodeId rhs) {
+        return Nodes_[lhs].Rank > Nodes_[rhs].Rank;
+    };
+    Roots_.clear();
+    for (TNodeId node = 0; node < Nodes_.size(); ++node) {
+        std::stable_sort(Nodes_[node].Successors.begin(), Nodes_[node].Successors.end(), byRank);
+        if (Nodes_[node].PredecessorCount == 0) {
+            Roots_.push_back(node);
+        }
+    }
+    std::stable_sort(Roots_.begin(), Roots_.end(), byRank);
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NCommon
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <common/future.h>
+#include <common/intrusive_ptr.h>
+#include <common/refcounted.h>
+#include <common/task.h>
+#include <common/threadpool.h>
+
+#include <atomic>
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+
+namespace NCommon {
+
+////////////////////////////////////////////////////////////////////////////////
+
+enum class ETaskGraphNodeState {
+    // Not finished in the last run, or never run.
+    Pending,
+    Succeeded,
+    Failed,
+    // Not run because a node it depends on failed or was skipped.
+    Skipped,
+};
+
+// Dependency graph of tasks run on a TInvoker. A node is submitted as soon as
+// the last node it depends on succeeds; nothing ever blocks waiting for a
+// dependency, every node keeps an atomic count of unfinished predecessors
+// instead. A node fails if its body throws, returns an error TErrorOr or a
+// future that resolves with one, and then everything downstream of it is
+// skipped while independent branches go on.
+//
+// Ready nodes are started in critical-path order: the longer the chain of
+// costs below a node, the earlier it goes. The first ready successor of a
+// node that finished synchronously runs right away on the same thread.
+//
+//     auto graph = New<TTaskGraph>();
+//     auto load = graph->AddNode([] { ... });
+//     auto parse = graph->AddNode([] { ... });
+//     graph->AddEdge(load, parse);
+//     graph->Run(invoker).Get().ThrowOnError();
+class TTaskGraph
+    : public NRefCounted::TRefCountedBase
+{
+public:
+    using TNodeId = size_t;
+
+    // |body| returns void, TErrorOr<void> or TFuture<void>; a future lets the
+    // node finish asynchronously without holding a worker. |cost| is the
+    // relative run time used for critical-path ordering.
+    template <typename F>
+    TNodeId AddNode(F&& body, double cost = 1.0) {
+        using TResult = std::invoke_result_t<std::decay_t<F>&>;
+        static_assert(
+            std::is_void_v<TResult> || std::is_same_v<TResult, TErrorOr<void>> || std::is_same_v<TResult, TFuture<void>>,
+            "Task graph node must return void, TErrorOr<void> or TFuture<void>");
+
+        return DoAddNode([body = std::forward<F>(body)] () mutable -> TFuture<void> {
+            if constexpr (std::is_void_v<TResult>) {
+                body();
+                return MakeFuture();
+            } else if constexpr (std::is_same_v<TResult, TErrorOr<void>>) {
+                return MakeFuture(body());
+            } else {
+                return body();
+            }
+        }, cost);
+    }
+
+    // |to| starts only after |from| has succeeded.
+    void AddEdge(TNodeId from, TNodeId to);
+
+    size_t GetNodeCount() const;
+
+    // Resolves once every node has finished or been skipped, with the first
+    // failure if any. Fails right away if the edges form a cycle or the
+    // previous run is still going; the graph must not be changed meanwhile.
+    TFuture<void> Run(TIntrusivePtr<TInvoker> invoker);
+
+    // Outcome of |node| in the last run; stable once its future resolved.
+    ETaskGraphNodeState GetNodeState(TNodeId node) const;
+
+private:
+    class TExecution;
+
+    struct TNode {
+        TUniqueFunction<TFuture<void>()> Body;
+        double Cost = 1.0;
+        // Sorted by Rank, highest first, when a run starts.
+        std::vector<TNodeId> Successors;
+        size_t PredecessorCount = 0;
+        // Cost of the most expensive path from this node to a sink.
+        double Rank = 0.0;
+    };
+
+    TNodeId DoAddNode(TUniqueFunction<TFuture<void>()> body, double cost);
+
+    // Computes ranks and orders successors and roots by them. Returns false on
+    // a cycle.
+    bool Prepare();
+
+    std::vector<TNode> Nodes_;
+    std::vector<TNodeId> Roots_;
+    std::vector<ETaskGraphNodeState> States_;
+    std::atomic<bool> Running_{false};
+};
+
+DECLARE_REFCOUNTED(TTaskGraph);
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NCommon
@@ -1,46 +1,1069 @@
+#include <common/cpu_topology.h>
+#include <common/json.h>
+#include <common/logging.h>
 #include <common/threadpool.h>
 
+#include <algorithm>
 #include <atomic>
+#include <tuple>
+#include <utility>
 
 namespace NCommon {
 
 ////////////////////////////////////////////////////////////////////////////////
 
-TThreadPool::TThreadPool(size_t numThreads)
-    : stop_(false)
+namespace {
+
+thread_local TThreadPool* CurrentPool = nullptr;
+thread_local size_t CurrentWorkerIndex = 0;
+
+// Pause instructions between two polls of the queues while spinning.
+constexpr size_t IdleSpinBatch = 64;
+
+// Why the task being destroyed right now was dropped; see DropTask.
+thread_local EErrorCode DropReason = EErrorCode::Generic;
+
+// For counters written by a single thread: no read-modify-write needed.
+void AddRelaxed(std::atomic<uint64_t>& counter, uint64_t delta) {
+    counter.store(counter.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+}
+
+int64_t GetNanoseconds() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+const char* GetPriorityName(size_t lane) {
+    switch (static_cast<EPriority>(lane)) {
+        case EPriority::High:
+            return "high";
+        case EPriority::Normal:
+            return "normal";
+        case EPriority::Low:
+            return "low";
+    }
+    return "unknown";
+}
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////
+
+TException MakeDroppedTaskError() {
+    switch (DropReason) {
+        case EErrorCode::DeadlineExceeded:
+            return TException(EErrorCode::DeadlineExceeded, "Task deadline expired before it started");
+        case EErrorCode::Overloaded:
+            return TException(EErrorCode::Overloaded, "Task shed by a full thread pool");
+        default:
+            return TException(DropReason, "Task dropped without running");
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+NJson::TJsonNode TThreadPoolStatistics::ToJson() const {
+    NJson::TJsonNode result;
+    result["enabled"] = Enabled;
+
+    THistogramSnapshot waitTime;
+    THistogramSnapshot runTime;
+    NJson::TJsonNode lanes;
+    for (size_t lane = 0; lane < PriorityCount; ++lane) {
+        const auto& statistics = Lanes[lane];
+        NJson::TJsonNode node;
+        node["enqueued"] = statistics.Enqueued;
+        node["executed"] = statistics.Executed;
+        node["expired"] = statistics.Expired;
+        node["rejected"] = statistics.Rejected;
+        node["queue_depth"] = statistics.QueueDepth;
+        node["busy_ns"] = static_cast<int64_t>(statistics.BusyTime.count());
+        node["wait_time_ns"] = statistics.WaitTime.ToJson();
+        node["run_time_ns"] = statistics.RunTime.ToJson();
+        lanes[GetPriorityName(lane)] = std::move(node);
+        waitTime.Merge(statistics.WaitTime);
+        runTime.Merge(statistics.RunTime);
+    }
+    result["lanes"] = std::move(lanes);
+    result["wait_time_ns"] = waitTime.ToJson();
+    result["run_time_ns"] = runTime.ToJson();
+
+    NJson::TJsonNode workers = std::vector<NJson::TJsonNode>();
+    for (const auto& statistics : Workers) {
+        NJson::TJsonNode node;
+        node["executed"] = statistics.Executed;
+        node["busy_ns"] = static_cast<int64_t>(statistics.BusyTime.count());
+        node["idle_ns"] = static_cast<int64_t>(statistics.IdleTime.count());
+        workers.push_back(std::move(node));
+    }
+    result["workers"] = std::move(workers);
+    return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+TThreadPool::TThreadPool(size_t numThreads, TThreadPoolOptions options)
+    : options_(options),
+      min_threads_(numThreads),
+      stop_(false)
 {
-    for (size_t i = 0; i < numThreads; ++i) {
-        workers_.emplace_back(&TThreadPool::Worker, this);
+    const size_t slots = std::max(numThreads, options_.MaxThreads);
+    PlaceWorkers(slots);
+    // Heaps and DropOldest need the mutex-guarded queues.
+    if (options_.Backend == EQueueBackend::LockFree && !options_.EarliestDeadlineFirst &&
+        options_.OverflowPolicy != EOverflowPolicy::DropOldest)
+    {
+        for (auto& node : nodes_) {
+            for (auto& ring : node.Rings) {
+                ring = std::make_unique<TBoundedMpmcQueue<TQueuedTask>>(options_.QueueCapacity);
+            }
+        }
+    }
+    for (size_t i = 0; i < slots; ++i) {
+        worker_counters_.push_back(std::make_unique<TWorkerCounters>());
+    }
+    if constexpr (ThreadPoolStatisticsCompiled) {
+        statistics_enabled_.store(options_.EnableStatistics, std::memory_order_relaxed);
+    }
+    if (options_.LifoSlot) {
+        options_.WorkStealing = true;
+    }
+    if (options_.WorkStealing) {
+        for (size_t i = 0; i < slots; ++i) {
+            local_queues_.push_back(std::make_unique<TLocalQueue>());
+        }
+    }
+
+    workers_.resize(slots);
+    slot_active_.assign(slots, false);
+    {
+        std::lock_guard<std::mutex> spawnLock(spawn_mutex_);
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        for (size_t i = 0; i < numThreads; ++i) {
+            slot_active_[i] = true;
+            workers_[i] = std::thread(&TThreadPool::Worker, this, i);
+        }
+        active_threads_.store(numThreads, std::memory_order_relaxed);
+    }
+    if (IsElastic()) {
+        supervisor_ = std::thread(&TThreadPool::Supervisor, this);
     }
 }
 
 TThreadPool::~TThreadPool() {
+    // A task dropping the last reference destroys the pool on one of its own
+    // workers. That worker cannot join itself: it is detached instead and
+    // leaves its loop, without touching the pool, once it sees CurrentPool
+    // cleared.
+    if (IsWorkerThread()) {
+        CurrentPool = nullptr;
+    }
+
+    stop_.store(true, std::memory_order_release);
+    event_count_.NotifyAll();
     {
-        std::unique_lock<std::mutex> lock(queue_mutex_);
-        stop_.store(true, std::memory_order_release);
+        std::lock_guard<std::mutex> lock(supervisor_mutex_);
     }
-    cv_.notify_all();
-    for (std::thread& worker : workers_) {
-        worker.join();
+    supervisor_cv_.notify_all();
+    if (supervisor_.joinable()) {
+        supervisor_.join();
+    }
+
+    // A worker may be inside TrySpawn, so never join while holding
+    // spawn_mutex_; TrySpawn gives up once stop_ is set.
+    while (true) {
+        std::vector<std::thread> threads;
+        {
+            std::lock_guard<std::mutex> lock(spawn_mutex_);
+            for (auto& worker : workers_) {
+                if (worker.joinable()) {
+                    threads.push_back(std::move(worker));
+                }
+            }
+        }
+        if (threads.empty()) {
+            break;
+        }
+        for (auto& thread : threads) {
+            if (thread.get_id() == std::this_thread::get_id()) {
+                thread.detach();
+            } else {
+                thread.join();
+            }
+        }
     }
 }
 
-void TThreadPool::Worker() {
+bool TThreadPool::IsWorkerThread() const {
+    return CurrentPool == this;
+}
+
+TThreadPool* TThreadPool::GetCurrent() {
+    return CurrentPool;
+}
+
+size_t TThreadPool::GetThreadCount() const {
+    return active_threads_.load(std::memory_order_relaxed);
+}
+
+size_t TThreadPool::GetMaxThreadCount() const {
+    return workers_.size();
+}
+
+bool TThreadPool::IsElastic() const {
+    return workers_.size() > min_threads_;
+}
+
+bool TThreadPool::TrySpawn(bool force) {
+    auto now = GetNanoseconds();
+    if (!force) {
+        auto last = last_spawn_ns_.load(std::memory_order_relaxed);
+        auto cooldown = std::chrono::duration_cast<std::chrono::nanoseconds>(options_.SpawnWaitThreshold).count();
+        if (now - last < cooldown || !last_spawn_ns_.compare_exchange_strong(last, now, std::memory_order_relaxed)) {
+            return false;
+        }
+    }
+
+    std::lock_guard<std::mutex> spawnLock(spawn_mutex_);
+    if (stop_.load(std::memory_order_acquire)) {
+        return false;
+    }
+
+    size_t slot = 0;
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        while (slot < slot_active_.size() && slot_active_[slot]) {
+            ++slot;
+        }
+        if (slot == slot_active_.size()) {
+            return false;
+        }
+        slot_active_[slot] = true;
+        active_threads_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // A retired worker may still be returning from Worker.
+    if (workers_[slot].joinable()) {
+        workers_[slot].join();
+    }
+    workers_[slot] = std::thread(&TThreadPool::Worker, this, slot);
+    last_spawn_ns_.store(now, std::memory_order_relaxed);
+    return true;
+}
+
+void TThreadPool::Supervisor() {
+    // Catches workers that are all stuck in long tasks: nothing completes and
+    // nobody dequeues, so the wait time check in RunTask never fires.
+    uint64_t lastExecuted = 0;
+    std::unique_lock<std::mutex> lock(supervisor_mutex_);
     while (!stop_.load(std::memory_order_acquire)) {
-        std::function<void()> task;
+        supervisor_cv_.wait_for(lock, options_.SpawnWaitThreshold);
+
+        uint64_t executed = GetExecutedCount();
+        bool stalled = executed == lastExecuted;
+        lastExecuted = executed;
+
+        if (stalled && event_count_.GetWaiterCount() == 0) {
+            bool pending;
+            {
+                std::lock_guard<std::mutex> queueLock(queue_mutex_);
+                pending = HasSharedTasks() || HasLocalTasks();
+            }
+            if (pending) {
+                lock.unlock();
+                TrySpawn(/*force*/ false);
+                lock.lock();
+            }
+        }
+    }
+}
+
+void TThreadPool::OnBlockingBegin() {
+    size_t blocked = blocked_threads_.fetch_add(1, std::memory_order_relaxed) + 1;
+    if (GetThreadCount() < min_threads_ + blocked) {
+        TrySpawn(/*force*/ true);
+    }
+}
+
+void TThreadPool::OnBlockingEnd() {
+    // Surplus workers retire through the idle timeout.
+    blocked_threads_.fetch_sub(1, std::memory_order_relaxed);
+}
+
+size_t TThreadPool::GetNodeCount() const {
+    return nodes_.size();
+}
+
+void TThreadPool::PlaceWorkers(size_t numThreads) {
+    const auto& topology = TCpuTopology::Get();
+
+    std::vector<int> cpus = options_.Cpus;
+    std::sort(cpus.begin(), cpus.end());
+    cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+    const bool restricted = !cpus.empty();
+    if (!restricted) {
+        cpus = topology.GetCpus();
+    }
+
+    worker_nodes_.assign(numThreads, 0);
+    worker_cpus_.assign(numThreads, {});
+    topology_nodes_.assign(topology.GetNodeCount(), 0);
+
+    if (!options_.NumaAware) {
+        for (size_t i = 0; i < numThreads; ++i) {
+            if (options_.PinWorkers) {
+                worker_cpus_[i] = {cpus[i % cpus.size()]};
+            } else if (restricted) {
+                worker_cpus_[i] = cpus;
+            }
+        }
+        nodes_.resize(1);
+        return;
+    }
+
+    // Allowed CPUs in node-major order; worker i takes the CPU at the same
+    // relative position, which splits workers in proportion to node sizes.
+    std::vector<std::vector<int>> nodeCpus(topology.GetNodeCount());
+    for (int cpu : cpus) {
+        nodeCpus[topology.GetNodeOf(cpu)].push_back(cpu);
+    }
+    std::vector<int> ordered;
+    for (const auto& group : nodeCpus) {
+        ordered.insert(ordered.end(), group.begin(), group.end());
+    }
+
+    std::fill(topology_nodes_.begin(), topology_nodes_.end(), -1);
+    for (size_t i = 0; i < numThreads; ++i) {
+        int cpu = ordered[i * ordered.size() / numThreads];
+        size_t topologyNode = topology.GetNodeOf(cpu);
+        if (topology_nodes_[topologyNode] < 0) {
+            topology_nodes_[topologyNode] = nodes_.size();
+            nodes_.emplace_back();
+        }
+        worker_nodes_[i] = topology_nodes_[topologyNode];
+        if (options_.PinWorkers) {
+            worker_cpus_[i] = {cpu};
+        } else {
+            worker_cpus_[i] = nodeCpus[topologyNode];
+        }
+    }
+    if (nodes_.empty()) {
+        nodes_.resize(1);
+    }
+}
+
+size_t TThreadPool::GetSubmitNode() {
+    if (nodes_.size() == 1) {
+        return 0;
+    }
+    if (CurrentPool == this) {
+        return worker_nodes_[CurrentWorkerIndex];
+    }
+    int node = topology_nodes_[TCpuTopology::Get().GetNodeOf(GetCurrentCpu())];
+    if (node >= 0) {
+        return node;
+    }
+    return next_node_.fetch_add(1, std::memory_order_relaxed) % nodes_.size();
+}
+
+TLaneStatistics TThreadPool::GetLaneStatistics(EPriority priority) const {
+    const auto& counters = lane_counters_[static_cast<size_t>(priority)];
+    TLaneStatistics statistics;
+    statistics.Enqueued = counters.Enqueued.load(std::memory_order_relaxed);
+    statistics.Executed = counters.Executed.load(std::memory_order_relaxed);
+    statistics.Expired = counters.Expired.load(std::memory_order_relaxed);
+    statistics.Rejected = counters.Rejected.load(std::memory_order_relaxed);
+
+    const size_t lane = static_cast<size_t>(priority);
+    for (const auto& node : nodes_) {
+        if (node.Rings[lane]) {
+            statistics.QueueDepth += node.Rings[lane]->SizeApprox();
+        } else {
+            std::lock_guard<std::mutex> lock(queue_mutex_);
+            statistics.QueueDepth += node.Tasks[lane].size() + node.Heaps[lane].size();
+        }
+    }
+    if (priority == EPriority::Normal) {
+        for (const auto& queue : local_queues_) {
+            std::lock_guard<std::mutex> lock(queue->Mutex);
+            statistics.QueueDepth += queue->Tasks.size();
+        }
+    }
+
+    for (const auto& worker : worker_counters_) {
+        statistics.Enqueued += worker->Enqueued[lane].load(std::memory_order_relaxed);
+        statistics.Executed += worker->Executed[lane].load(std::memory_order_relaxed);
+        statistics.BusyTime += std::chrono::nanoseconds(worker->BusyNanoseconds[lane].load(std::memory_order_relaxed));
+        statistics.WaitTime.Merge(worker->WaitTime[lane].GetSnapshot());
+        statistics.RunTime.Merge(worker->RunTime[lane].GetSnapshot());
+    }
+    return statistics;
+}
+
+TThreadPoolStatistics TThreadPool::GetStatistics() const {
+    TThreadPoolStatistics statistics;
+    statistics.Enabled = IsStatisticsEnabled();
+    for (size_t lane = 0; lane < PriorityCount; ++lane) {
+        statistics.Lanes[lane] = GetLaneStatistics(static_cast<EPriority>(lane));
+    }
+    for (const auto& worker : worker_counters_) {
+        auto& item = statistics.Workers.emplace_back();
+        for (size_t lane = 0; lane < PriorityCount; ++lane) {
+            item.Executed += worker->Executed[lane].load(std::memory_order_relaxed);
+            item.BusyTime += std::chrono::nanoseconds(worker->BusyNanoseconds[lane].load(std::memory_order_relaxed));
+        }
+        item.IdleTime = std::chrono::nanoseconds(worker->IdleNanoseconds.load(std::memory_order_relaxed));
+    }
+    return statistics;
+}
+
+void TThreadPool::SetStatisticsEnabled(bool enabled) {
+    if constexpr (ThreadPoolStatisticsCompiled) {
+        statistics_enabled_.store(enabled, std::memory_order_relaxed);
+    }
+}
+
+bool TThreadPool::IsStatisticsEnabled() const {
+    return ThreadPoolStatisticsCompiled && statistics_enabled_.load(std::memory_order_relaxed);
+}
+
+TThreadPool::TWorkerCounters* TThreadPool::GetCurrentWorkerCounters() const {
+    return CurrentPool == this ? worker_counters_[CurrentWorkerIndex].get() : nullptr;
+}
+
+uint64_t TThreadPool::GetExecutedCount() const {
+    uint64_t executed = 0;
+    for (const auto& counters : lane_counters_) {
+        executed += counters.Executed.load(std::memory_order_relaxed);
+    }
+    for (const auto& worker : worker_counters_) {
+        for (const auto& counter : worker->Executed) {
+            executed += counter.load(std::memory_order_relaxed);
+        }
+    }
+    return executed;
+}
+
+bool TThreadPool::Submit(TTask& task, EPriority priority, const TSubmitOptions& options) {
+    const size_t lane = static_cast<size_t>(priority);
+    if (!TryReserveSlot()) {
+        return false;
+    }
+
+    TQueuedTask queued{std::move(task)};
+    if (IsStatisticsEnabled() || IsElastic()) {
+        queued.EnqueuedAt = GetNanoseconds();
+    }
+    if (options.Deadline != NoDeadline) {
+        queued.Deadline = std::chrono::duration_cast<std::chrono::nanoseconds>(options.Deadline.time_since_epoch()).count();
+    }
+    queued.Sheddable = options.Sheddable;
+
+    // Counted up front so that Executed never overtakes Enqueued. Workers
+    // count their own submissions, other threads share the lane counter.
+    auto* workerCounters = GetCurrentWorkerCounters();
+    if (workerCounters) {
+        AddRelaxed(workerCounters->Enqueued[lane], 1);
+    } else {
+        lane_counters_[lane].Enqueued.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (!TryPushLane(queued, lane)) {
+        if (workerCounters) {
+            AddRelaxed(workerCounters->Enqueued[lane], -1);
+        } else {
+            lane_counters_[lane].Enqueued.fetch_sub(1, std::memory_order_relaxed);
+        }
+        ReleaseSlot();
+        task = std::move(queued.Task);
+        return false;
+    }
+    return true;
+}
+
+void TThreadPool::OnOverflow(TTask& task, EPriority priority, const TSubmitOptions& options) {
+    const size_t lane = static_cast<size_t>(priority);
+
+    auto policy = options_.OverflowPolicy;
+    if (!options.Sheddable && (policy == EOverflowPolicy::Fail || policy == EOverflowPolicy::DropOldest)) {
+        policy = EOverflowPolicy::Block;
+    }
+
+    switch (policy) {
+        case EOverflowPolicy::Block:
+            break;
+
+        case EOverflowPolicy::RunInCaller:
+            RunInline(priority, task);
+            return;
+
+        case EOverflowPolicy::DropOldest: {
+            TQueuedTask victim;
+            size_t victimLane;
+            // Another producer may take the freed slot first.
+            while (TryPopOldest(lane, victim, victimLane)) {
+                ReleaseSlot();
+                lane_counters_[victimLane].Rejected.fetch_add(1, std::memory_order_relaxed);
+                DropTask(victim, EErrorCode::Overloaded);
+                if (Submit(task, priority, options)) {
+                    return;
+                }
+            }
+            // Nothing older to shed, so the newcomer goes.
+            [[fallthrough]];
+        }
+
+        case EOverflowPolicy::Fail: {
+            lane_counters_[lane].Rejected.fetch_add(1, std::memory_order_relaxed);
+            TQueuedTask queued{std::move(task)};
+            DropTask(queued, EErrorCode::Overloaded);
+            return;
+        }
+    }
+
+    while (!IsWorkerThread()) {
+        // Registered as a waiter before the retry, so a slot freed after it
+        // comes with a notification.
+        auto key = space_event_.PrepareWait();
+        if (Submit(task, priority, options)) {
+            space_event_.CancelWait();
+            return;
+        }
+        space_event_.Wait(key);
+        if (Submit(task, priority, options)) {
+            return;
+        }
+    }
+    RunInline(priority, task);
+}
+
+bool TThreadPool::TryPopOldest(size_t lane, TQueuedTask& task, size_t& victimLane) {
+    const size_t own = GetSubmitNode();
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    // Lower priorities have higher lane indices and go first.
+    for (size_t candidate = PriorityCount; candidate-- > lane;) {
+        for (size_t offset = 0; offset < nodes_.size(); ++offset) {
+            auto& node = nodes_[(own + offset) % nodes_.size()];
+
+            if (options_.EarliestDeadlineFirst) {
+                // Linear, but only paid on overflow.
+                auto& heap = node.Heaps[candidate];
+                auto oldest = heap.end();
+                for (auto it = heap.begin(); it != heap.end(); ++it) {
+                    if (it->Sheddable && (oldest == heap.end() || it->Sequence < oldest->Sequence)) {
+                        oldest = it;
+                    }
+                }
+                if (oldest == heap.end()) {
+                    continue;
+                }
+                task = std::move(*oldest);
+                heap.erase(oldest);
+                std::make_heap(heap.begin(), heap.end(), IsLaterDeadline);
+            } else {
+                auto& tasks = node.Tasks[candidate];
+                auto oldest = std::find_if(tasks.begin(), tasks.end(), [] (const TQueuedTask& queued) {
+                    return queued.Sheddable;
+                });
+                if (oldest == tasks.end()) {
+                    continue;
+                }
+                task = std::move(*oldest);
+                tasks.erase(oldest);
+            }
+            victimLane = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool TThreadPool::IsQueueCounted() const {
+    return options_.MaxQueuedTasks != 0 || options_.HighWatermark != 0;
+}
+
+bool TThreadPool::TryReserveSlot() {
+    if (!IsQueueCounted()) {
+        return true;
+    }
+
+    size_t queued = queued_tasks_.fetch_add(1, std::memory_order_relaxed) + 1;
+    if (options_.MaxQueuedTasks != 0 && queued > options_.MaxQueuedTasks) {
+        queued_tasks_.fetch_sub(1, std::memory_order_relaxed);
+        return false;
+    }
+    if (options_.HighWatermark != 0 && queued >= options_.HighWatermark &&
+        !above_high_watermark_.exchange(true, std::memory_order_relaxed) &&
+        options_.OnHighWatermark)
+    {
+        options_.OnHighWatermark(queued);
+    }
+    return true;
+}
+
+void TThreadPool::ReleaseSlot() {
+    if (IsQueueCounted()) {
+        size_t queued = queued_tasks_.fetch_sub(1, std::memory_order_relaxed) - 1;
+        if (queued <= options_.LowWatermark && above_high_watermark_.load(std::memory_order_relaxed) &&
+            above_high_watermark_.exchange(false, std::memory_order_relaxed) &&
+            options_.OnLowWatermark)
+        {
+            options_.OnLowWatermark(queued);
+        }
+    }
+    if (options_.MaxQueuedTasks != 0 || options_.Backend == EQueueBackend::LockFree) {
+        space_event_.NotifyOne();
+    }
+}
+
+void TThreadPool::RunInline(EPriority priority, TTask& task) {
+    lane_counters_[static_cast<size_t>(priority)].Enqueued.fetch_add(1, std::memory_order_relaxed);
+    TQueuedTask queued{std::move(task)};
+    RunTask(priority, queued, nullptr);
+}
+
+bool TThreadPool::TryPushLane(TQueuedTask& task, size_t lane) {
+    if (lane == static_cast<size_t>(EPriority::Normal) && CurrentPool == this && !local_queues_.empty() &&
+        !options_.EarliestDeadlineFirst)
+    {
+        auto& queue = *local_queues_[CurrentWorkerIndex];
+        if (options_.LifoSlot) {
+            // Only the owner sees the slot, so nobody needs waking up.
+            std::swap(task, queue.LifoSlot);
+            if (!task.Task) {
+                return true;
+            }
+        }
+        {
+            std::lock_guard<std::mutex> lock(queue.Mutex);
+            queue.Tasks.push_back(std::move(task));
+        }
+        event_count_.NotifyOne();
+        return true;
+    }
+
+    return TryPushShared(task, lane, GetSubmitNode());
+}
+
+bool TThreadPool::TryPushShared(TQueuedTask& task, size_t lane, size_t node) {
+    if (auto& ring = nodes_[node].Rings[lane]) {
+        if (!ring->TryPush(std::move(task))) {
+            return false;
+        }
+        event_count_.NotifyOne();
+        return true;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        if (options_.EarliestDeadlineFirst) {
+            auto& heap = nodes_[node].Heaps[lane];
+            task.Sequence = next_sequence_++;
+            heap.push_back(std::move(task));
+            std::push_heap(heap.begin(), heap.end(), IsLaterDeadline);
+        } else {
+            nodes_[node].Tasks[lane].push_back(std::move(task));
+        }
+    }
+    event_count_.NotifyOne();
+    return true;
+}
+
+bool TThreadPool::TryPopShared(size_t index, size_t lane, size_t node, TQueuedTask& task) {
+    // Only the Normal lane has local queues to batch into.
+    const bool stealing = !local_queues_.empty() && lane == static_cast<size_t>(EPriority::Normal);
+
+    if (auto& ring = nodes_[node].Rings[lane]) {
+        if (!ring->TryPop(task)) {
+            return false;
+        }
+        if (stealing) {
+            size_t batch = std::min(ring->SizeApprox() / std::max<size_t>(GetThreadCount(), 1), options_.StealBatch);
+            auto& own = *local_queues_[index];
+            TQueuedTask extra;
+            for (size_t i = 0; i < batch && ring->TryPop(extra); ++i) {
+                std::lock_guard<std::mutex> localLock(own.Mutex);
+                own.Tasks.push_back(std::move(extra));
+            }
+        }
+        return true;
+    }
+
+    std::unique_lock<std::mutex> lock(queue_mutex_);
+    if (options_.EarliestDeadlineFirst) {
+        // No batching into the local queue: it would lose the order.
+        auto& heap = nodes_[node].Heaps[lane];
+        if (heap.empty()) {
+            return false;
+        }
+        std::pop_heap(heap.begin(), heap.end(), IsLaterDeadline);
+        task = std::move(heap.back());
+        heap.pop_back();
+        return true;
+    }
+
+    auto& tasks = nodes_[node].Tasks[lane];
+    if (tasks.empty()) {
+        return false;
+    }
+    task = std::move(tasks.front());
+    tasks.pop_front();
+
+    // Take a share of the shared queue so that the next pops are local.
+    if (stealing && !tasks.empty()) {
+        size_t batch = std::min(tasks.size() / std::max<size_t>(GetThreadCount(), 1), options_.StealBatch);
+        auto& own = *local_queues_[index];
+        std::lock_guard<std::mutex> localLock(own.Mutex);
+        for (size_t i = 0; i < batch; ++i) {
+            own.Tasks.push_back(std::move(tasks.front()));
+            tasks.pop_front();
+        }
+    }
+    return true;
+}
+
+bool TThreadPool::HasSharedTasks() const {
+    for (const auto& node : nodes_) {
+        for (size_t lane = 0; lane < PriorityCount; ++lane) {
+            if (node.Rings[lane] ? !node.Rings[lane]->Empty() : !node.Tasks[lane].empty() || !node.Heaps[lane].empty()) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool TThreadPool::IsLaterDeadline(const TQueuedTask& lhs, const TQueuedTask& rhs) {
+    return std::tie(lhs.Deadline, lhs.Sequence) > std::tie(rhs.Deadline, rhs.Sequence);
+}
+
+size_t TThreadPool::PickLane(std::array<int64_t, PriorityCount>& credits) const {
+    size_t best = 0;
+    int64_t total = 0;
+    for (size_t lane = 0; lane < PriorityCount; ++lane) {
+        auto weight = static_cast<int64_t>(options_.LaneWeights[lane]);
+        credits[lane] += weight;
+        total += weight;
+        if (credits[lane] > credits[best]) {
+            best = lane;
+        }
+    }
+    credits[best] -= total;
+    return best;
+}
+
+bool TThreadPool::TryPopLane(size_t index, size_t lane, TQueuedTask& task, bool sharedFirst) {
+    const bool local = lane == static_cast<size_t>(EPriority::Normal) && !local_queues_.empty();
+    if (local && !sharedFirst && TryPopLocal(index, task)) {
+        return true;
+    }
+    const size_t own = worker_nodes_[index];
+    for (size_t offset = 0; offset < nodes_.size(); ++offset) {
+        if (TryPopShared(index, lane, (own + offset) % nodes_.size(), task)) {
+            return true;
+        }
+    }
+    return local && sharedFirst && TryPopLocal(index, task);
+}
+
+void TThreadPool::RunTask(EPriority priority, TQueuedTask& task, TWorkerCounters* counters) {
+    const size_t lane = static_cast<size_t>(priority);
+    const bool onWorker = IsWorkerThread();
+    const bool measure = counters && IsStatisticsEnabled();
+    const bool elastic = task.EnqueuedAt != 0 && IsElastic();
+
+    // The clock is only read when something needs it.
+    int64_t start = 0;
+    if (measure || elastic || task.Deadline != std::numeric_limits<int64_t>::max()) {
+        start = GetNanoseconds();
+    }
+    if (start > task.Deadline) {
+        lane_counters_[lane].Expired.fetch_add(1, std::memory_order_relaxed);
+        if (options_.DropExpiredTasks) {
+            DropTask(task, EErrorCode::DeadlineExceeded);
+            return;
+        }
+    }
+    if (measure && task.EnqueuedAt != 0) {
+        counters->WaitTime[lane].Record(std::max<int64_t>(start - task.EnqueuedAt, 0));
+    }
+    if (elastic && std::chrono::nanoseconds(start - task.EnqueuedAt) > options_.SpawnWaitThreshold)
+    {
+        TrySpawn(/*force*/ false);
+    }
+
+    task.Task();
+
+    if (onWorker && !IsWorkerThread()) {
+        // The task destroyed the pool.
+        return;
+    }
+    if (!counters) {
+        lane_counters_[lane].Executed.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    AddRelaxed(counters->Executed[lane], 1);
+    if (measure) {
+        auto elapsed = GetNanoseconds() - start;
+        counters->RunTime[lane].Record(elapsed);
+        AddRelaxed(counters->BusyNanoseconds[lane], elapsed);
+    }
+}
+
+void TThreadPool::DropTask(TQueuedTask& task, EErrorCode reason) {
+    // Run futures resolve from the task's destructor and pick the reason up.
+    auto previous = std::exchange(DropReason, reason);
+    task.Task.Reset();
+    DropReason = previous;
+}
+
+bool TThreadPool::TryPopLocal(size_t index, TQueuedTask& task) {
+    auto& queue = *local_queues_[index];
+    std::lock_guard<std::mutex> lock(queue.Mutex);
+    if (queue.Tasks.empty()) {
+        return false;
+    }
+    task = std::move(queue.Tasks.front());
+    queue.Tasks.pop_front();
+    return true;
+}
+
+void TThreadPool::SpillLifoSlot(size_t index) {
+    auto& queue = *local_queues_[index];
+    if (!queue.LifoSlot.Task) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(queue.Mutex);
+        queue.Tasks.push_back(std::exchange(queue.LifoSlot, {}));
+    }
+    event_count_.NotifyOne();
+}
+
+bool TThreadPool::TrySteal(size_t index, TQueuedTask& task) {
+    const size_t count = local_queues_.size();
+    std::deque<TQueuedTask> stolen;
+
+    // Same-node victims first, then the rest.
+    for (size_t pass = 0; pass < 2 && stolen.empty(); ++pass) {
+        for (size_t offset = 1; offset < count && stolen.empty(); ++offset) {
+            size_t victimIndex = (index + offset) % count;
+            bool sameNode = worker_nodes_[victimIndex] == worker_nodes_[index];
+            if (sameNode != (pass == 0)) {
+                continue;
+            }
+            auto& victim = *local_queues_[victimIndex];
+            std::lock_guard<std::mutex> lock(victim.Mutex);
+            size_t batch = std::min((victim.Tasks.size() + 1) / 2, options_.StealBatch);
+            for (size_t i = 0; i < batch; ++i) {
+                stolen.push_back(std::move(victim.Tasks.front()));
+                victim.Tasks.pop_front();
+            }
+        }
+    }
+
+    if (stolen.empty()) {
+        return false;
+    }
+
+    task = std::move(stolen.front());
+    stolen.pop_front();
+    if (!stolen.empty()) {
+        auto& own = *local_queues_[index];
+        std::lock_guard<std::mutex> lock(own.Mutex);
+        for (auto& item : stolen) {
+            own.Tasks.push_back(std::move(item));
+        }
+    }
+    return true;
+}
+
+bool TThreadPool::HasLocalTasks() {
+    for (auto& queue : local_queues_) {
+        std::lock_guard<std::mutex> lock(queue->Mutex);
+        if (!queue->Tasks.empty()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool TThreadPool::Park(size_t index) {
+    while (true) {
+        // Registered as a waiter before the recheck, so a task pushed after it
+        // comes with a notification.
+        auto key = event_count_.PrepareWait();
+        bool pending;
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex_);
+            pending = HasSharedTasks();
+        }
+        if (pending || HasLocalTasks()) {
+            event_count_.CancelWait();
+            return true;
+        }
+        if (stop_.load(std::memory_order_acquire)) {
+            event_count_.CancelWait();
+            return false;
+        }
+
+        if (!IsElastic()) {
+            event_count_.Wait(key);
+            return true;
+        }
+        if (event_count_.WaitFor(key, options_.IdleTimeout)) {
+            return true;
+        }
+
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        if (active_threads_.load(std::memory_order_relaxed) > min_threads_ + blocked_threads_.load(std::memory_order_relaxed) &&
+            !HasSharedTasks() && !HasLocalTasks())
         {
-            std::unique_lock<std::mutex> lock(queue_mutex_);
-            cv_.wait(lock, [this] { return stop_.load(std::memory_order_acquire) || !tasks_.empty(); });
-            if (stop_.load(std::memory_order_acquire) && tasks_.empty()) {
-                return;
+            slot_active_[index] = false;
+            active_threads_.fetch_sub(1, std::memory_order_relaxed);
+            return false;
+        }
+    }
+}
+
+void TThreadPool::Worker(size_t index) {
+    CurrentPool = this;
+    CurrentWorkerIndex = index;
+
+    if (!worker_cpus_[index].empty() && !SetCurrentThreadAffinity(worker_cpus_[index])) {
+        LOG_WARNING("Failed to set affinity of thread pool worker {}", index);
+    }
+
+    const bool stealing = !local_queues_.empty();
+    auto* lifoQueue = options_.LifoSlot ? local_queues_[index].get() : nullptr;
+    auto* counters = worker_counters_.empty() ? nullptr : worker_counters_[index].get();
+    std::array<int64_t, PriorityCount> credits{};
+    size_t lifoPolls = 0;
+    uint64_t pops = 0;
+    size_t spins = 0;
+    size_t yields = 0;
+    int64_t idleSince = 0;
+
+    while (true) {
+        // The previous task, destroyed at the end of the iteration, may have
+        // held the last reference to the pool.
+        if (CurrentPool != this) {
+            return;
+        }
+
+        TQueuedTask task;
+        std::optional<size_t> popped;
+
+        if (lifoQueue && lifoQueue->LifoSlot.Task) {
+            if (lifoPolls < options_.MaxLifoPolls) {
+                task = std::exchange(lifoQueue->LifoSlot, {});
+                popped = static_cast<size_t>(EPriority::Normal);
+                ++lifoPolls;
+            } else {
+                SpillLifoSlot(index);
+            }
+        }
+
+        if (!popped) {
+            lifoPolls = 0;
+            const bool sharedFirst = stealing && options_.GlobalQueueInterval != 0 &&
+                ++pops % options_.GlobalQueueInterval == 0;
+
+            // The picked lane goes first; if it is empty the others are tried
+            // in priority order and the turn is lost.
+            size_t preferred = PickLane(credits);
+            if (TryPopLane(index, preferred, task, sharedFirst)) {
+                popped = preferred;
+            } else {
+                for (size_t lane = 0; lane < PriorityCount; ++lane) {
+                    if (lane != preferred && TryPopLane(index, lane, task, sharedFirst)) {
+                        popped = lane;
+                        break;
+                    }
+                }
             }
-            task = std::move(tasks_.front());
-            tasks_.pop();
+            if (!popped && stealing && TrySteal(index, task)) {
+                popped = static_cast<size_t>(EPriority::Normal);
+            }
+        }
+
+        if (popped) {
+            ReleaseSlot();
+            if (idleSince != 0) {
+                AddRelaxed(counters->IdleNanoseconds, GetNanoseconds() - idleSince);
+                idleSince = 0;
+            }
+            spins = 0;
+            yields = 0;
+            RunTask(static_cast<EPriority>(*popped), task, counters);
+            continue;
+        }
+
+        // Spinning and yielding count as idle time, like parking.
+        if (idleSince == 0 && counters && IsStatisticsEnabled()) {
+            idleSince = GetNanoseconds();
+        }
+
+        if (spins < options_.IdleSpinIterations) {
+            for (size_t i = 0; i < IdleSpinBatch && spins < options_.IdleSpinIterations; ++i, ++spins) {
+                SpinLockPause();
+            }
+            continue;
+        }
+        if (yields < options_.IdleYieldIterations) {
+            ++yields;
+            std::this_thread::yield();
+            continue;
         }
-        task();
+
+        spins = 0;
+        yields = 0;
+        if (!Park(index)) {
+            if (idleSince != 0) {
+                AddRelaxed(counters->IdleNanoseconds, GetNanoseconds() - idleSince);
+            }
+            return;
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+TBlockingScope::TBlockingScope()
+    : Pool_(CurrentPool && CurrentPool->IsElastic() ? CurrentPool : nullptr)
+{
+    // The slot would otherwise wait for the blocking call to return.
+    if (CurrentPool && CurrentPool->options_.LifoSlot) {
+        CurrentPool->SpillLifoSlot(CurrentWorkerIndex);
+    }
+    if (Pool_) {
+        Pool_->OnBlockingBegin();
     }
 }
 
+TBlockingScope::~TBlockingScope() {
+    if (Pool_) {
+        Pool_->OnBlockingEnd();
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+TSwitchToAwaiter::TSwitchToAwaiter(TIntrusivePtr<TInvoker> invoker)
+    : Invoker_(std::move(invoker))
+{}
+
+void TSwitchToAwaiter::await_suspend(std::coroutine_handle<> handle) const {
+    // The coroutine may resume and destroy this awaiter before Invoke returns.
+    auto invoker = Invoker_;
+    invoker->Invoke([handle] {
+        handle.resume();
+    });
+}
+
+const TIntrusivePtr<TInvoker>& TSwitchToAwaiter::GetInvoker() const {
+    return Invoker_;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 
 } // namespace NCommon
@@ -1,15 +1,30 @@
 #pragma once
 
+#include <common/cancellation.h>
+#include <common/event_count.h>
 #include <common/exception.h>
+#include <common/histogram.h>
 #include <common/intrusive_ptr.h>
+#include <common/mpmc_queue.h>
+#include <common/task.h>
 
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <coroutine>
+#include <cstdint>
+#include <deque>
 #include <functional>
-#include <future>
+#include <limits>
+#include <memory>
 #include <mutex>
 #include <optional>
 #include <queue>
+#include <stdexcept>
 #include <thread>
+#include <type_traits>
+#include <utility>
 #include <variant>
 #include <vector>
 
@@ -17,72 +32,547 @@ namespace NCommon {
 
 ////////////////////////////////////////////////////////////////////////////////
 
+enum class EQueueBackend {
+    // std::queue guarded by the pool mutex.
+    Mutex,
+    // Bounded lock-free ring; producers never take a lock unless a worker
+    // has to be woken up.
+    LockFree,
+};
+
+enum class EPriority {
+    High,
+    Normal,
+    Low,
+};
+
+constexpr size_t PriorityCount = 3;
+
+// Latest steady clock time a task is still worth starting at.
+using TDeadline = std::chrono::steady_clock::time_point;
+
+constexpr TDeadline NoDeadline = TDeadline::max();
+
+// What a full pool does with a task that does not fit.
+enum class EOverflowPolicy {
+    // Wait for space.
+    Block,
+    // Fail the task: futures of TInvoker::Run resolve with an
+    // EErrorCode::Overloaded error.
+    Fail,
+    // Fail the oldest queued task of the same or a lower priority instead.
+    DropOldest,
+    // Run the task right away on the submitting thread.
+    RunInCaller,
+};
+
+// Per-submission parameters of TThreadPool::enqueue and TInvoker::Invoke.
+struct TSubmitOptions {
+    TDeadline Deadline = NoDeadline;
+    // The overflow policy may fail or drop the task. Only set for tasks that
+    // report it, like those of TInvoker::Run; the others wait for space (or
+    // run inline on a worker) under Fail and DropOldest.
+    bool Sheddable = false;
+};
+
+// Instrumentation is compiled in with COMMON_THREADPOOL_STATISTICS and then
+// switched on per pool; otherwise only the per-lane counters are kept.
+#ifdef COMMON_THREADPOOL_STATISTICS
+constexpr bool ThreadPoolStatisticsCompiled = true;
+#else
+constexpr bool ThreadPoolStatisticsCompiled = false;
+#endif
+
+struct TLaneStatistics {
+    uint64_t Enqueued = 0;
+    uint64_t Executed = 0;
+    // Tasks that reached a worker after their deadline, whether or not they
+    // were run.
+    uint64_t Expired = 0;
+    // Tasks failed or dropped by the overflow policy.
+    uint64_t Rejected = 0;
+    // Tasks sitting in the lane's queues when the snapshot was taken.
+    size_t QueueDepth = 0;
+    // Wall time workers spent running tasks of the lane; only measured while
+    // statistics are enabled.
+    std::chrono::nanoseconds BusyTime{0};
+    // Enqueue-to-start and run times in nanoseconds, merged over workers;
+    // empty unless statistics are enabled.
+    THistogramSnapshot WaitTime;
+    THistogramSnapshot RunTime;
+};
+
+struct TWorkerStatistics {
+    uint64_t Executed = 0;
+    // Only measured while statistics are enabled, like IdleTime.
+    std::chrono::nanoseconds BusyTime{0};
+    std::chrono::nanoseconds IdleTime{0};
+};
+
+struct TThreadPoolStatistics {
+    bool Enabled = false;
+    // Indexed by EPriority.
+    std::array<TLaneStatistics, PriorityCount> Lanes;
+    std::vector<TWorkerStatistics> Workers;
+
+    NJson::TJsonNode ToJson() const;
+};
+
+struct TThreadPoolOptions {
+    EQueueBackend Backend = EQueueBackend::Mutex;
+
+    // Capacity of every lane of the shared queue for the LockFree backend
+    // (rounded up to a power of two).
+    size_t QueueCapacity = 65536;
+
+    // Give every worker its own deque: tasks submitted from a pool thread stay
+    // local, idle workers steal from the others. External submissions still
+    // go through the shared queue.
+    bool WorkStealing = false;
+
+    // Upper bound on tasks moved at once from the shared queue or a victim.
+    size_t StealBatch = 32;
+
+    // A Normal task submitted from a worker goes to that worker's single
+    // LIFO slot and runs as soon as the current task returns, on a warm
+    // cache; whatever occupied the slot moves to the back of the local queue.
+    // The slot cannot be stolen, so a task that is about to block should do
+    // it in a TBlockingScope, which hands the slot over to the local queue.
+    // Implies WorkStealing.
+    bool LifoSlot = false;
+
+    // Tasks a worker takes from its slot in a row before serving the queues
+    // again, so that a chain of continuations cannot monopolize it.
+    size_t MaxLifoPolls = 3;
+
+    // With local queues, every GlobalQueueInterval-th pop of a worker looks
+    // at the shared queues before its own, so that external submissions are
+    // not starved by workers that keep feeding themselves. 0 disables.
+    size_t GlobalQueueInterval = 61;
+
+    // Share of pops each lane gets while all of them have work, indexed by
+    // EPriority. Lanes are picked by smooth weighted round-robin, so a lane
+    // with a non-zero weight is never starved; an empty lane yields its turn.
+    std::array<size_t, PriorityCount> LaneWeights = {16, 4, 1};
+
+    // Collect wait/run time histograms and per-worker busy/idle time. Ignored
+    // unless compiled with COMMON_THREADPOOL_STATISTICS.
+    bool EnableStatistics = false;
+
+    // CPUs the workers may run on; empty means every online CPU and no
+    // affinity unless pinning or NUMA placement asks for it.
+    std::vector<int> Cpus;
+
+    // Pin every worker to a single CPU of Cpus instead of the whole set.
+    bool PinWorkers = false;
+
+    // Spread workers over the NUMA nodes of Cpus in proportion to their CPU
+    // counts and give every node its own shared queues. A worker serves its
+    // node first and steals from same-node workers first; external
+    // submissions go to the node the submitter runs on.
+    bool NumaAware = false;
+
+    // Elastic mode, enabled when MaxThreads exceeds the constructor's thread
+    // count (which becomes the minimum). A worker is added when a task waited
+    // longer than SpawnWaitThreshold before starting, when no task completed
+    // for that long while all workers are busy, or when a worker enters a
+    // TBlockingScope. Workers above the minimum retire after IdleTimeout
+    // without work.
+    size_t MaxThreads = 0;
+    std::chrono::microseconds SpawnWaitThreshold{1000};
+    std::chrono::milliseconds IdleTimeout{10000};
+
+    // Idle policy. A worker that finds no work spins for up to
+    // IdleSpinIterations pause instructions, then yields up to
+    // IdleYieldIterations times, polling the queues in between, and only then
+    // parks on a futex. Spinning shortens pickup latency for bursty loads at
+    // the cost of CPU time and only pays off when workers have CPUs to
+    // themselves; the defaults park right away.
+    size_t IdleSpinIterations = 0;
+    size_t IdleYieldIterations = 0;
+
+    // Earliest-deadline-first: every lane of the shared queue becomes a heap
+    // ordered by submission deadline; tasks without one go last, in FIFO
+    // order. Implies the Mutex backend, and submissions from workers bypass
+    // the local queues.
+    bool EarliestDeadlineFirst = false;
+
+    // Destroy tasks that reach a worker after their deadline instead of
+    // running them; futures of TInvoker::Run resolve with an
+    // EErrorCode::DeadlineExceeded error.
+    bool DropExpiredTasks = false;
+
+    // Upper bound on tasks queued over all lanes, nodes and local queues; 0
+    // means unbounded. The LockFree backend is bounded by QueueCapacity per
+    // lane on top of that.
+    size_t MaxQueuedTasks = 0;
+
+    // Applied to enqueue when a bound is hit; TryEnqueue just returns false.
+    // DropOldest implies the Mutex backend.
+    EOverflowPolicy OverflowPolicy = EOverflowPolicy::Block;
+
+    // OnHighWatermark fires once the number of queued tasks reaches
+    // HighWatermark, OnLowWatermark once it falls back to LowWatermark; both
+    // are called on the thread that crossed the mark with the current count
+    // and must not block. HighWatermark of 0 disables them.
+    size_t HighWatermark = 0;
+    size_t LowWatermark = 0;
+    std::function<void(size_t)> OnHighWatermark;
+    std::function<void(size_t)> OnLowWatermark;
+};
+
 class TThreadPool {
 public:
-    explicit TThreadPool(size_t numThreads);
+    explicit TThreadPool(size_t numThreads, TThreadPoolOptions options = {});
 
     ~TThreadPool();
 
+    // Applies the overflow policy when the pool is full. Under Block a worker
+    // of this pool runs the task inline instead of waiting: if every worker
+    // waited for space nobody would be left to drain the queue.
     template <typename F, typename... Args>
-    void enqueue(F&& f) {
-        {
-            std::unique_lock<std::mutex> lock(queue_mutex_);
-            tasks_.emplace(std::forward<F>(f));
+    void enqueue(F&& f, EPriority priority = EPriority::Normal, const TSubmitOptions& options = {}) {
+        TTask task(std::forward<F>(f));
+        if (!Submit(task, priority, options)) {
+            OnOverflow(task, priority, options);
         }
-        cv_.notify_one();
     }
 
-private:
-    void Worker();
+    // Returns false instead of applying the overflow policy.
+    template <typename F>
+    bool TryEnqueue(F&& f, EPriority priority = EPriority::Normal, const TSubmitOptions& options = {}) {
+        TTask task(std::forward<F>(f));
+        return Submit(task, priority, options);
+    }
+
+    bool IsWorkerThread() const;
+
+    // The pool the calling thread is a worker of, null elsewhere.
+    static TThreadPool* GetCurrent();
+
+    // Currently running workers; varies over time for an elastic pool.
+    size_t GetThreadCount() const;
+
+    size_t GetMaxThreadCount() const;
+
+    // Number of per-node sub-pools; 1 unless NumaAware found several nodes.
+    size_t GetNodeCount() const;
 
+    TLaneStatistics GetLaneStatistics(EPriority priority) const;
+
+    // Merges the per-worker histograms; cheap enough to poll, but not free.
+    TThreadPoolStatistics GetStatistics() const;
+
+    void SetStatisticsEnabled(bool enabled);
+
+    bool IsStatisticsEnabled() const;
+
+private:
+    struct TQueuedTask {
+        TTask Task;
+        // Submission time in steady clock nanoseconds, 0 if not measured.
+        int64_t EnqueuedAt = 0;
+        // Steady clock nanoseconds, INT64_MAX if none.
+        int64_t Deadline = std::numeric_limits<int64_t>::max();
+        // Keeps equal deadlines in FIFO order in the heaps.
+        uint64_t Sequence = 0;
+        bool Sheddable = false;
+    };
+
+    struct TLocalQueue {
+        std::mutex Mutex;
+        std::deque<TQueuedTask> Tasks;
+        // Touched by the owning worker only, so not guarded by Mutex; free
+        // while its Task is empty.
+        TQueuedTask LifoSlot;
+    };
+
+    // Shared queues of one NUMA node; Tasks and Heaps are guarded by
+    // queue_mutex_. Heaps replace Tasks under EarliestDeadlineFirst.
+    struct TNodeQueues {
+        std::array<std::unique_ptr<TBoundedMpmcQueue<TQueuedTask>>, PriorityCount> Rings;
+        std::array<std::deque<TQueuedTask>, PriorityCount> Tasks;
+        std::array<std::vector<TQueuedTask>, PriorityCount> Heaps;
+    };
+
+    // Written by the owning worker only, so per-task bookkeeping touches no
+    // cache line shared with other workers; lane totals are merged on read.
+    struct alignas(64) TWorkerCounters {
+        std::array<THistogram, PriorityCount> WaitTime;
+        std::array<THistogram, PriorityCount> RunTime;
+        // Submitted by this worker, per lane.
+        std::array<std::atomic<uint64_t>, PriorityCount> Enqueued{};
+        std::array<std::atomic<uint64_t>, PriorityCount> Executed{};
+        std::array<std::atomic<uint64_t>, PriorityCount> BusyNanoseconds{};
+        std::atomic<uint64_t> IdleNanoseconds{0};
+    };
+
+    // Tasks submitted or run inline by threads other than the pool's workers,
+    // plus the rare expirations and rejections.
+    struct alignas(64) TLaneCounters {
+        std::atomic<uint64_t> Enqueued{0};
+        std::atomic<uint64_t> Executed{0};
+        std::atomic<uint64_t> Expired{0};
+        std::atomic<uint64_t> Rejected{0};
+    };
+
+    // Counters of the calling thread if it is a worker of this pool.
+    TWorkerCounters* GetCurrentWorkerCounters() const;
+    uint64_t GetExecutedCount() const;
+
+    // Leaves |task| untouched on failure.
+    bool Submit(TTask& task, EPriority priority, const TSubmitOptions& options);
+    void OnOverflow(TTask& task, EPriority priority, const TSubmitOptions& options);
+    // Removes the oldest sheddable task of |lane| or a lower priority lane
+    // from the shared queues.
+    bool TryPopOldest(size_t lane, TQueuedTask& task, size_t& victimLane);
+
+    // queued_tasks_ is only maintained when a bound or a watermark needs it.
+    bool IsQueueCounted() const;
+    bool TryReserveSlot();
+    // Frees the slot of a task that left the queues and wakes up a producer
+    // waiting for space.
+    void ReleaseSlot();
+
+    friend class TBlockingScope;
+
+    bool IsElastic() const;
+    // Starts a worker in a free slot; unless |force|d, at most one per
+    // SpawnWaitThreshold.
+    bool TrySpawn(bool force);
+    void Supervisor();
+    void OnBlockingBegin();
+    void OnBlockingEnd();
+
+    void PlaceWorkers(size_t numThreads);
+    size_t GetSubmitNode();
+
+    bool TryPushLane(TQueuedTask& task, size_t lane);
+    bool TryPushShared(TQueuedTask& task, size_t lane, size_t node);
+    bool TryPopShared(size_t index, size_t lane, size_t node, TQueuedTask& task);
+    bool HasSharedTasks() const;
+    // Heap order: the earliest deadline on top.
+    static bool IsLaterDeadline(const TQueuedTask& lhs, const TQueuedTask& rhs);
+
+    // Next lane to serve by smooth weighted round-robin over |credits|.
+    size_t PickLane(std::array<int64_t, PriorityCount>& credits) const;
+    // Local queues carry the Normal lane and go first unless |sharedFirst|;
+    // the worker's own node comes first.
+    bool TryPopLane(size_t index, size_t lane, TQueuedTask& task, bool sharedFirst);
+    // |counters| is null outside of workers.
+    void RunTask(EPriority priority, TQueuedTask& task, TWorkerCounters* counters);
+    void RunInline(EPriority priority, TTask& task);
+    // Destroys the task without running it; see MakeDroppedTaskError.
+    void DropTask(TQueuedTask& task, EErrorCode reason);
+
+    bool TryPopLocal(size_t index, TQueuedTask& task);
+    // Moves the LIFO slot of worker |index| to the back of its local queue,
+    // where other workers can steal it.
+    void SpillLifoSlot(size_t index);
+    bool TrySteal(size_t index, TQueuedTask& task);
+    bool HasLocalTasks();
+
+    // Returns false when the worker must exit: the pool stops or the worker
+    // retires.
+    bool Park(size_t index);
+
+    void Worker(size_t index);
+
+    TThreadPoolOptions options_;
+    std::vector<TNodeQueues> nodes_;
+    std::vector<size_t> worker_nodes_;
+    std::vector<std::vector<int>> worker_cpus_;
+    // Topology node id -> index in nodes_, or -1 for nodes without workers.
+    std::vector<int> topology_nodes_;
+    std::atomic<size_t> next_node_{0};
+    std::vector<std::unique_ptr<TLocalQueue>> local_queues_;
+    // Parked workers wait here; producers notify after every push.
+    TEventCount event_count_;
+    // Producers blocked by a full pool wait here; workers notify after pops.
+    TEventCount space_event_;
+    std::atomic<size_t> queued_tasks_{0};
+    std::atomic<bool> above_high_watermark_{false};
+
+    // One slot per possible worker; inactive slots keep their (empty) local
+    // queue and counters.
     std::vector<std::thread> workers_;
-    std::queue<std::function<void()>> tasks_;
-    std::mutex queue_mutex_;
-    std::condition_variable cv_;
+    std::vector<bool> slot_active_;
+    size_t min_threads_;
+    std::atomic<size_t> active_threads_{0};
+    std::atomic<size_t> blocked_threads_{0};
+    std::atomic<int64_t> last_spawn_ns_{0};
+    std::mutex spawn_mutex_;
+    std::thread supervisor_;
+    std::mutex supervisor_mutex_;
+    std::condition_variable supervisor_cv_;
+
+    std::array<TLaneCounters, PriorityCount> lane_counters_;
+    std::vector<std::unique_ptr<TWorkerCounters>> worker_counters_;
+    std::atomic<bool> statistics_enabled_{false};
+    mutable std::mutex queue_mutex_;
+    uint64_t next_sequence_ = 0;
     std::atomic<bool> stop_;
 };
 
 DECLARE_REFCOUNTED(TThreadPool);
 
+// Announces that the current task is about to block (I/O, a lock, a sleep).
+// On a worker of an elastic pool the pool starts a replacement right away so
+// that the number of runnable workers stays at the minimum; elsewhere it is
+// a no-op. A task waiting in the worker's LIFO slot is made stealable.
+class TBlockingScope {
+public:
+    TBlockingScope();
+    ~TBlockingScope();
+
+    TBlockingScope(const TBlockingScope&) = delete;
+    TBlockingScope& operator=(const TBlockingScope&) = delete;
+
+private:
+    TThreadPool* Pool_;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+class TSwitchToAwaiter;
+
+template <typename T>
+class TFuture;
+
+template <typename T>
+class TPromise;
+
+template <typename T>
+TPromise<T> NewPromise();
+
 ////////////////////////////////////////////////////////////////////////////////
 
+template <typename TError, typename Type>
+class TErrorOrBase;
+
+namespace NDetails {
+
+template <typename T>
+struct TIsErrorOr
+    : std::false_type
+{};
+
+template <typename TError, typename Type>
+struct TIsErrorOr<TErrorOrBase<TError, Type>>
+    : std::true_type
+{};
+
+// Exceptions other than TError itself that an error can be built from.
+template <typename UError, typename TError>
+concept CConvertibleError =
+    std::is_base_of_v<std::exception, UError> &&
+    !std::is_same_v<UError, TError> &&
+    !TIsErrorOr<UError>::value;
+
+} // namespace NDetails
+
+// Either a value or an error. Accessors follow the value category of the
+// holder, so reading a value never copies it and an rvalue hands its payload
+// over:
+//
+//     const auto& rows = future.Get().Value();
+//     auto rows = std::move(result).ValueOrThrow();
 template <typename TError, typename Type>
 class TErrorOrBase {
 public:
-    TErrorOrBase(Type value)
-        : Value_(value), IsOkay_(true) {}
+    using TValueType = Type;
+
+    TErrorOrBase(const Type& value)
+        : Value_(std::in_place_index<1>, value) {}
+
+    TErrorOrBase(Type&& value)
+        : Value_(std::in_place_index<1>, std::move(value)) {}
+
+    // Builds the value from |args| in place.
+    template <typename... Args>
+    explicit TErrorOrBase(std::in_place_t, Args&&... args)
+        : Value_(std::in_place_index<1>, std::forward<Args>(args)...) {}
 
     TErrorOrBase(const TError& error)
-        : Value_(error), IsOkay_(false) {}
+        : Value_(std::in_place_index<0>, error) {}
+
+    TErrorOrBase(TError&& error)
+        : Value_(std::in_place_index<0>, std::move(error)) {}
 
     template <typename UError>
+    requires NDetails::CConvertibleError<UError, TError>
     TErrorOrBase(const UError& error)
-        : Value_(TError(error)), IsOkay_(false) {}
+        : Value_(std::in_place_index<0>, error) {}
+
+    Type& Value() & {
+        return std::get<1>(Value_);
+    }
+
+    const Type& Value() const& {
+        return std::get<1>(Value_);
+    }
+
+    Type&& Value() && {
+        return std::get<1>(std::move(Value_));
+    }
+
+    Type& ValueOrThrow() & {
+        ThrowOnError();
+        return std::get<1>(Value_);
+    }
+
+    const Type& ValueOrThrow() const& {
+        ThrowOnError();
+        return std::get<1>(Value_);
+    }
 
-    Type Value() const {
-        return std::get<Type>(Value_);
+    Type&& ValueOrThrow() && {
+        ThrowOnError();
+        return std::get<1>(std::move(Value_));
     }
 
-    Type ValueOrThrow() const {
-        if (!IsOkay_) {
-            throw std::get<TError>(Value_);
+    const TError& Error() const& {
+        if (Value_.index() != 0) {
+            throw std::runtime_error("No error present");
         }
-        return std::get<Type>(Value_);
+        return std::get<0>(Value_);
     }
 
-    TError Error() const {
-        if (IsOkay_) {
+    TError&& Error() && {
+        if (Value_.index() != 0) {
             throw std::runtime_error("No error present");
         }
-        return std::get<Error>(Value_);
+        return std::get<0>(std::move(Value_));
     }
 
     void ThrowOnError() const {
-        if (!IsOkay_) {
-            throw std::get<TError>(Value_);
+        if (Value_.index() == 0) {
+            throw std::get<0>(Value_);
         }
     }
 
+    // TErrorOr<U> holding callback(Value()), or this error.
+    template <typename F>
+    auto Map(F&& callback) const& {
+        return DoMap(*this, std::forward<F>(callback));
+    }
+
+    template <typename F>
+    auto Map(F&& callback) && {
+        return DoMap(std::move(*this), std::forward<F>(callback));
+    }
+
+    // callback(Value()) returning a TErrorOr itself, or this error.
+    template <typename F>
+    auto AndThen(F&& callback) const& {
+        return DoAndThen(*this, std::forward<F>(callback));
+    }
+
+    template <typename F>
+    auto AndThen(F&& callback) && {
+        return DoAndThen(std::move(*this), std::forward<F>(callback));
+    }
+
     bool operator==(const TErrorOrBase& other) const {
         return Value_ == other.Value_;
     }
@@ -92,12 +582,39 @@ public:
     }
 
     explicit operator bool() const {
-        return IsOkay_;
+        return Value_.index() == 1;
     }
 
 private:
+    template <typename TSelf, typename F>
+    static auto DoMap(TSelf&& self, F&& callback) {
+        using TResult = std::remove_cvref_t<std::invoke_result_t<F, decltype(std::forward<TSelf>(self).Value())>>;
+        using TMapped = TErrorOrBase<TError, TResult>;
+
+        if (!self) {
+            return TMapped(std::forward<TSelf>(self).Error());
+        }
+        if constexpr (std::is_void_v<TResult>) {
+            std::invoke(std::forward<F>(callback), std::forward<TSelf>(self).Value());
+            return TMapped();
+        } else {
+            return TMapped(std::in_place, std::invoke(std::forward<F>(callback), std::forward<TSelf>(self).Value()));
+        }
+    }
+
+    template <typename TSelf, typename F>
+    static auto DoAndThen(TSelf&& self, F&& callback) {
+        using TResult = std::remove_cvref_t<std::invoke_result_t<F, decltype(std::forward<TSelf>(self).Value())>>;
+        static_assert(NDetails::TIsErrorOr<TResult>::value, "AndThen callback must return a TErrorOr");
+
+        if (!self) {
+            return TResult(std::forward<TSelf>(self).Error());
+        }
+        return std::invoke(std::forward<F>(callback), std::forward<TSelf>(self).Value());
+    }
+
+    // The error first, so that the index tells the outcome.
     std::variant<TError, Type> Value_;
-    bool IsOkay_;
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -105,28 +622,63 @@ private:
 template <typename TError>
 class TErrorOrBase<TError, void> {
 public:
-    TErrorOrBase()
-        : Value_({}), IsOkay_(true) {}
+    using TValueType = void;
+
+    TErrorOrBase() = default;
 
     TErrorOrBase(const TError& error)
-        : Value_(error), IsOkay_(false) {}
+        : Error_(error) {}
+
+    TErrorOrBase(TError&& error)
+        : Error_(std::move(error)) {}
 
     template <typename UError>
+    requires NDetails::CConvertibleError<UError, TError>
     TErrorOrBase(const UError& error)
-        : Value_(TError(error)), IsOkay_(false) {}
+        : Error_(std::in_place, error) {}
 
-    TError Error() const {
-        return Value_.value();
+    const TError& Error() const& {
+        if (!Error_) {
+            throw std::runtime_error("No error present");
+        }
+        return *Error_;
+    }
+
+    TError&& Error() && {
+        if (!Error_) {
+            throw std::runtime_error("No error present");
+        }
+        return *std::move(Error_);
     }
 
     void ThrowOnError() const {
-        if (!IsOkay_) {
-            throw std::get<TError>(Value_);
+        if (Error_) {
+            throw *Error_;
         }
     }
 
+    template <typename F>
+    auto Map(F&& callback) const& {
+        return DoMap(*this, std::forward<F>(callback));
+    }
+
+    template <typename F>
+    auto Map(F&& callback) && {
+        return DoMap(std::move(*this), std::forward<F>(callback));
+    }
+
+    template <typename F>
+    auto AndThen(F&& callback) const& {
+        return DoAndThen(*this, std::forward<F>(callback));
+    }
+
+    template <typename F>
+    auto AndThen(F&& callback) && {
+        return DoAndThen(std::move(*this), std::forward<F>(callback));
+    }
+
     bool operator==(const TErrorOrBase& other) const {
-        return Value_ == other.Value_;
+        return Error_ == other.Error_;
     }
 
     bool operator!=(const TErrorOrBase& other) const {
@@ -134,12 +686,38 @@ public:
     }
 
     explicit operator bool() const {
-        return IsOkay_;
+        return !Error_;
     }
 
 private:
-    std::optional<TError> Value_;
-    bool IsOkay_;
+    template <typename TSelf, typename F>
+    static auto DoMap(TSelf&& self, F&& callback) {
+        using TResult = std::remove_cvref_t<std::invoke_result_t<F>>;
+        using TMapped = TErrorOrBase<TError, TResult>;
+
+        if (!self) {
+            return TMapped(std::forward<TSelf>(self).Error());
+        }
+        if constexpr (std::is_void_v<TResult>) {
+            std::invoke(std::forward<F>(callback));
+            return TMapped();
+        } else {
+            return TMapped(std::in_place, std::invoke(std::forward<F>(callback)));
+        }
+    }
+
+    template <typename TSelf, typename F>
+    static auto DoAndThen(TSelf&& self, F&& callback) {
+        using TResult = std::remove_cvref_t<std::invoke_result_t<F>>;
+        static_assert(NDetails::TIsErrorOr<TResult>::value, "AndThen callback must return a TErrorOr");
+
+        if (!self) {
+            return TResult(std::forward<TSelf>(self).Error());
+        }
+        return std::invoke(std::forward<F>(callback));
+    }
+
+    std::optional<TError> Error_;
 };
 
 template <typename Type>
@@ -147,64 +725,211 @@ using TErrorOr = TErrorOrBase<::NCommon::TException, Type>;
 
 ////////////////////////////////////////////////////////////////////////////////
 
+// Error for a task destroyed without running. While the pool drops a task on
+// purpose (an expired deadline) the code says why; otherwise it is Generic.
+TException MakeDroppedTaskError();
+
+namespace NDetails {
+
+// Owns the promise of a TInvoker::Run task so that its future resolves even if
+// the task is destroyed without running, and the cancellation subscription
+// that may resolve it early, so that a shed task does not leave the callback
+// behind in a long-lived token.
+template <typename T>
+class TRunPromiseGuard {
+public:
+    TRunPromiseGuard(TPromise<T> promise, TCancellationToken token, TCancellationToken::TCookie cookie)
+        : Promise_(std::move(promise))
+        , Token_(std::move(token))
+        , Cookie_(cookie)
+    {}
+
+    TRunPromiseGuard(TRunPromiseGuard&& other)
+        : Promise_(std::move(other.Promise_))
+        , Token_(std::move(other.Token_))
+        , Cookie_(std::exchange(other.Cookie_, 0))
+    {}
+
+    ~TRunPromiseGuard() {
+        Unsubscribe();
+        if (Promise_ && !Promise_.IsSet()) {
+            Promise_.TrySet(TErrorOr<T>(MakeDroppedTaskError()));
+        }
+    }
+
+    const TPromise<T>& Get() const {
+        return Promise_;
+    }
+
+    const TCancellationToken& GetToken() const {
+        return Token_;
+    }
+
+    // After this no callback can resolve the promise behind the task's back.
+    void Unsubscribe() {
+        if (Cookie_ != 0) {
+            Token_.Unsubscribe(std::exchange(Cookie_, 0));
+        }
+    }
+
+private:
+    TPromise<T> Promise_;
+    TCancellationToken Token_;
+    TCancellationToken::TCookie Cookie_;
+};
+
+} // namespace NDetails
+
+////////////////////////////////////////////////////////////////////////////////
+
 class TInvoker {
 public:
-    explicit TInvoker(TIntrusivePtr<TThreadPool> threadPool)
-        : ThreadPool_(std::move(threadPool)) {}
+    explicit TInvoker(TIntrusivePtr<TThreadPool> threadPool, EPriority priority = EPriority::Normal)
+        : ThreadPool_(std::move(threadPool)), Priority_(priority) {}
 
+    virtual ~TInvoker() = default;
+
+    // The future resolves with an EErrorCode::Overloaded error if the pool
+    // sheds the task under the Fail or DropOldest overflow policy.
     template <typename Callable, typename... Args>
-    std::future<TErrorOr<std::invoke_result_t<Callable, Args...>>> Run(Callable&& callable, Args&&... args) {
-        using ReturnType = std::invoke_result_t<Callable, Args...>;
+    TFuture<std::invoke_result_t<Callable, Args...>> Run(Callable&& callable, Args&&... args) {
+        return DoRun({}, NoDeadline, std::forward<Callable>(callable), std::forward<Args>(args)...);
+    }
 
-        auto promise = std::make_shared<std::promise<TErrorOr<ReturnType>>>();
-        auto future = promise->get_future();
+    // If |token| is cancelled before the task starts, the task is dropped and
+    // the future resolves with an EErrorCode::Cancelled error right away. A
+    // running task is not interrupted but may poll |token| itself.
+    template <typename Callable, typename... Args>
+    TFuture<std::invoke_result_t<Callable, Args...>> Run(TCancellationToken token, Callable&& callable, Args&&... args) {
+        return DoRun(std::move(token), NoDeadline, std::forward<Callable>(callable), std::forward<Args>(args)...);
+    }
 
+    // Ordered by |deadline| under EarliestDeadlineFirst and, with
+    // DropExpiredTasks, failed with EErrorCode::DeadlineExceeded if it does not
+    // start in time.
+    template <typename Callable, typename... Args>
+    TFuture<std::invoke_result_t<Callable, Args...>> Run(TDeadline deadline, Callable&& callable, Args&&... args) {
+        return DoRun({}, deadline, std::forward<Callable>(callable), std::forward<Args>(args)...);
+    }
 
-        ThreadPool_->enqueue([callable = std::forward<Callable>(callable),
-                     args = std::tuple(std::forward<Args>(args)...),
-                     promise]() mutable {
-            try {
-                promise->set_value(TErrorOr<ReturnType>(
-                    std::apply(callable, args)
-                ));
-            } catch (std::exception& ex) {
-                promise->set_value(TErrorOr<ReturnType>(ex));
-            }
-        });
+    // Fire-and-forget submission without a future. Every other submission
+    // path goes through here, so wrappers only need to override this.
+    virtual void Invoke(TTask task) {
+        ThreadPool_->enqueue(std::move(task), Priority_);
+    }
 
-        return future;
+    // Wrappers that cannot honour |options| fall back to Invoke(task).
+    virtual void Invoke(TTask task, const TSubmitOptions& options) {
+        ThreadPool_->enqueue(std::move(task), Priority_, options);
+    }
+
+    // co_await invoker->Yield() reschedules the coroutine onto this invoker.
+    TSwitchToAwaiter Yield();
+
+    const TIntrusivePtr<TThreadPool>& GetThreadPool() const {
+        return ThreadPool_;
     }
 
+    EPriority GetPriority() const {
+        return Priority_;
+    }
+
+    // Counters and histograms of the lane this invoker submits to.
+    TLaneStatistics GetStatistics() const {
+        return ThreadPool_->GetLaneStatistics(Priority_);
+    }
+
+private:
     template <typename Callable, typename... Args>
-    requires(std::is_same_v<std::invoke_result_t<Callable, Args...>, void>)
-    std::future<TErrorOr<void>> Run(Callable&& callable, Args&&... args) {
-        auto promise = std::make_shared<std::promise<TErrorOr<void>>>();
-        auto future = promise->get_future();
+    TFuture<std::invoke_result_t<Callable, Args...>> DoRun(
+        TCancellationToken token,
+        TDeadline deadline,
+        Callable&& callable,
+        Args&&... args)
+    {
+        using ReturnType = std::invoke_result_t<Callable, Args...>;
 
+        auto promise = NewPromise<ReturnType>();
+        auto future = promise.ToFuture();
 
-        ThreadPool_->enqueue([callable = std::forward<Callable>(callable),
-                     args = std::tuple(std::forward<Args>(args)...),
-                     promise]() mutable {
+        if (token.IsCancelled()) {
+            promise.Set(TErrorOr<ReturnType>(MakeCancelledError()));
+            return future;
+        }
+        TCancellationToken::TCookie cookie = 0;
+        if (token.CanBeCancelled()) {
+            cookie = token.Subscribe([promise] {
+                promise.TrySet(TErrorOr<ReturnType>(MakeCancelledError()));
+            });
+        }
+
+        TTask task([callable = std::forward<Callable>(callable),
+                    args = std::tuple(std::forward<Args>(args)...),
+                    guard = NDetails::TRunPromiseGuard<ReturnType>(std::move(promise), std::move(token), cookie)
+                   ]() mutable {
+            const auto& promise = guard.Get();
+            guard.Unsubscribe();
+            if (guard.GetToken().IsCancelled()) {
+                promise.TrySet(TErrorOr<ReturnType>(MakeCancelledError()));
+                return;
+            }
             try {
-                std::apply(
-                    std::forward<Callable>(callable),
-                    std::move(args)
-                );
-                promise->set_value(TErrorOr<void>());
+                if constexpr (std::is_void_v<ReturnType>) {
+                    std::apply(callable, std::move(args));
+                    promise.Set(TErrorOr<void>());
+                } else {
+                    promise.Set(TErrorOr<ReturnType>(
+                        std::apply(callable, std::move(args))
+                    ));
+                }
             } catch (std::exception& ex) {
-                promise->set_value(TErrorOr<void>(ex));
+                promise.Set(TErrorOr<ReturnType>(ex));
             }
         });
 
+        // The guard resolves the future if the pool sheds the task.
+        TSubmitOptions options;
+        options.Deadline = deadline;
+        options.Sheddable = true;
+        Invoke(std::move(task), options);
         return future;
     }
 
-private:
     TIntrusivePtr<TThreadPool> ThreadPool_;
+    EPriority Priority_;
+};
+
+DECLARE_POOLED_LONG_LIVED_REFCOUNTED(TInvoker);
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Suspends the awaiting coroutine and resumes it on a pool thread of |invoker|.
+class TSwitchToAwaiter {
+public:
+    explicit TSwitchToAwaiter(TIntrusivePtr<TInvoker> invoker);
+
+    bool await_ready() const noexcept {
+        return false;
+    }
+
+    void await_suspend(std::coroutine_handle<> handle) const;
+
+    void await_resume() const noexcept
+    {}
+
+    const TIntrusivePtr<TInvoker>& GetInvoker() const;
+
+private:
+    TIntrusivePtr<TInvoker> Invoker_;
 };
 
-DECLARE_REFCOUNTED(TInvoker);
+inline TSwitchToAwaiter TInvoker::Yield() {
+    return TSwitchToAwaiter(TIntrusivePtr<TInvoker>(this));
+}
 
 ////////////////////////////////////////////////////////////////////////////////
 
 } // namespace NCommon
+
+// TInvoker::Run returns TFuture.
+#include <common/future.h>
@@ -0,0 +1,97 @@
+#include <common/cpu_topology.h>
+#include <common/threadpool_config.h>
+
+#include <thread>
+
+namespace NCommon {
+
+////////////////////////////////////////////////////////////////////////////////
+
+void TThreadPoolConfig::RegisterConfig() {
+    TThreadPoolOptions defaults;
+
+    Register("thread_count", &ThreadCount).Default(std::max(1u, std::thread::hardware_concurrency()));
+    Register("backend", &Backend).Default("mutex");
+    Register("queue_capacity", &QueueCapacity).Default(defaults.QueueCapacity);
+    Register("work_stealing", &WorkStealing).Default(defaults.WorkStealing);
+    Register("steal_batch", &StealBatch).Default(defaults.StealBatch);
+    Register("lifo_slot", &LifoSlot).Default(defaults.LifoSlot);
+    Register("max_lifo_polls", &MaxLifoPolls).Default(defaults.MaxLifoPolls);
+    Register("global_queue_interval", &GlobalQueueInterval).Default(defaults.GlobalQueueInterval);
+    Register("lane_weights", &LaneWeights).Default(std::vector<size_t>(
+        defaults.LaneWeights.begin(),
+        defaults.LaneWeights.end()));
+    Register("enable_statistics", &EnableStatistics).Default(defaults.EnableStatistics);
+    Register("cpus", &Cpus).Default("");
+    Register("pin_workers", &PinWorkers).Default(defaults.PinWorkers);
+    Register("numa_aware", &NumaAware).Default(defaults.NumaAware);
+    Register("max_threads", &MaxThreads).Default(defaults.MaxThreads);
+    Register("spawn_wait_threshold_us", &SpawnWaitThresholdUs).Default(defaults.SpawnWaitThreshold.count());
+    Register("idle_timeout_ms", &IdleTimeoutMs).Default(defaults.IdleTimeout.count());
+    Register("idle_spin_iterations", &IdleSpinIterations).Default(defaults.IdleSpinIterations);
+    Register("idle_yield_iterations", &IdleYieldIterations).Default(defaults.IdleYieldIterations);
+    Register("earliest_deadline_first", &EarliestDeadlineFirst).Default(defaults.EarliestDeadlineFirst);
+    Register("drop_expired_tasks", &DropExpiredTasks).Default(defaults.DropExpiredTasks);
+    Register("max_queued_tasks", &MaxQueuedTasks).Default(defaults.MaxQueuedTasks);
+    Register("overflow_policy", &OverflowPolicy).Default("block");
+    Register("high_watermark", &HighWatermark).Default(defaults.HighWatermark);
+    Register("low_watermark", &LowWatermark).Default(defaults.LowWatermark);
+}
+
+void TThreadPoolConfig::Postprocess() {
+    ASSERT(ThreadCount > 0, "thread_count must be positive");
+    ASSERT(Backend == "mutex" || Backend == "lock_free", "backend must be \"mutex\" or \"lock_free\"");
+    ASSERT(LaneWeights.size() == PriorityCount, "lane_weights must have one weight per priority");
+    ASSERT(
+        OverflowPolicy == "block" || OverflowPolicy == "fail" ||
+        OverflowPolicy == "drop_oldest" || OverflowPolicy == "run_in_caller",
+        "overflow_policy must be \"block\", \"fail\", \"drop_oldest\" or \"run_in_caller\"");
+    ASSERT(LowWatermark <= HighWatermark, "low_watermark must not exceed high_watermark");
+    ASSERT(MaxThreads == 0 || MaxThreads >= ThreadCount, "max_threads must be 0 or at least thread_count");
+    // Validates the list early instead of at pool construction.
+    TCpuTopology::ParseCpuList(Cpus);
+}
+
+TThreadPoolOptions TThreadPoolConfig::ToOptions() const {
+    TThreadPoolOptions options;
+    options.Backend = Backend == "lock_free" ? EQueueBackend::LockFree : EQueueBackend::Mutex;
+    options.QueueCapacity = QueueCapacity;
+    options.WorkStealing = WorkStealing;
+    options.StealBatch = StealBatch;
+    options.LifoSlot = LifoSlot;
+    options.MaxLifoPolls = MaxLifoPolls;
+    options.GlobalQueueInterval = GlobalQueueInterval;
+    std::copy(LaneWeights.begin(), LaneWeights.end(), options.LaneWeights.begin());
+    options.EnableStatistics = EnableStatistics;
+    options.Cpus = TCpuTopology::ParseCpuList(Cpus);
+    options.PinWorkers = PinWorkers;
+    options.NumaAware = NumaAware;
+    options.MaxThreads = MaxThreads;
+    options.SpawnWaitThreshold = std::chrono::microseconds(SpawnWaitThresholdUs);
+    options.IdleTimeout = std::chrono::milliseconds(IdleTimeoutMs);
+    options.IdleSpinIterations = IdleSpinIterations;
+    options.IdleYieldIterations = IdleYieldIterations;
+    options.EarliestDeadlineFirst = EarliestDeadlineFirst;
+    options.DropExpiredTasks = DropExpiredTasks;
+    options.MaxQueuedTasks = MaxQueuedTasks;
+    if (OverflowPolicy == "fail") {
+        options.OverflowPolicy = EOverflowPolicy::Fail;
+    } else if (OverflowPolicy == "drop_oldest") {
+        options.OverflowPolicy = EOverflowPolicy::DropOldest;
+    } else if (OverflowPolicy == "run_in_caller") {
+        options.OverflowPolicy = EOverflowPolicy::RunInCaller;
+    } else {
+        options.OverflowPolicy = EOverflowPolicy::Block;
+    }
+    options.HighWatermark = HighWatermark;
+    options.LowWatermark = LowWatermark;
+    return options;
+}
+
+TThreadPoolPtr TThreadPoolConfig::CreateThreadPool() const {
+    return New<TThreadPool>(ThreadCount, ToOptions());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NCommon
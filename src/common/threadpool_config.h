@@ -0,0 +1,74 @@
+#pragma once
+
+#include <common/config.h>
+#include <common/threadpool.h>
+
+#include <string>
+#include <vector>
+
+namespace NCommon {
+
+////////////////////////////////////////////////////////////////////////////////
+
+// JSON form of TThreadPoolOptions so that placement can be tuned per host:
+//
+// {
+//     "thread_count": 16,
+//     "backend": "lock_free",
+//     "cpus": "0-7,16-23",
+//     "pin_workers": true,
+//     "numa_aware": true,
+//     "max_threads": 64,
+//     "spawn_wait_threshold_us": 1000,
+//     "idle_timeout_ms": 10000,
+//     "max_queued_tasks": 100000,
+//     "overflow_policy": "fail"
+// }
+//
+// Watermark callbacks are not configurable; set them on the options.
+class TThreadPoolConfig
+    : public TConfigBase
+{
+public:
+    size_t ThreadCount;
+    // "mutex" or "lock_free".
+    std::string Backend;
+    size_t QueueCapacity;
+    bool WorkStealing;
+    size_t StealBatch;
+    bool LifoSlot;
+    size_t MaxLifoPolls;
+    size_t GlobalQueueInterval;
+    // High, normal and low lane weights.
+    std::vector<size_t> LaneWeights;
+    bool EnableStatistics;
+    // Kernel CPU list format; empty means every online CPU.
+    std::string Cpus;
+    bool PinWorkers;
+    bool NumaAware;
+    // Elastic mode if above thread_count; 0 keeps the pool fixed.
+    size_t MaxThreads;
+    size_t SpawnWaitThresholdUs;
+    size_t IdleTimeoutMs;
+    size_t IdleSpinIterations;
+    size_t IdleYieldIterations;
+    bool EarliestDeadlineFirst;
+    bool DropExpiredTasks;
+    size_t MaxQueuedTasks;
+    // "block", "fail", "drop_oldest" or "run_in_caller".
+    std::string OverflowPolicy;
+    size_t HighWatermark;
+    size_t LowWatermark;
+
+    void RegisterConfig() override;
+
+    void Postprocess() override;
+
+    TThreadPoolOptions ToOptions() const;
+
+    TThreadPoolPtr CreateThreadPool() const;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NCommon
@@ -0,0 +1,161 @@
+#include <common/timer_wheel.h>
+
+namespace NCommon {
+
+////////////////////////////////////////////////////////////////////////////////
+
+TTimerEntry::TTimerEntry(uint64_t deadlineTick, TTask callback)
+    : DeadlineTick_(deadlineTick)
+    , Callback_(std::move(callback))
+{}
+
+uint64_t TTimerEntry::GetDeadlineTick() const {
+    return DeadlineTick_;
+}
+
+bool TTimerEntry::IsCancelled() const {
+    return Cancelled_;
+}
+
+void TTimerEntry::Cancel() {
+    Cancelled_ = true;
+    Callback_.Reset();
+}
+
+TTask TTimerEntry::ExtractCallback() {
+    return std::move(Callback_);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void TTimerWheel::Insert(TTimerEntryPtr entry) {
+    ++Size_;
+    Place(std::move(entry), nullptr);
+}
+
+void TTimerWheel::Place(TTimerEntryPtr entry, std::vector<TTimerEntryPtr>* ready) {
+    uint64_t deadline = entry->GetDeadlineTick();
+    if (deadline <= CurrentTick_) {
+        if (ready) {
+            --Size_;
+            ready->push_back(std::move(entry));
+            return;
+        }
+        deadline = CurrentTick_ + 1;
+    }
+
+    uint64_t delta = deadline - CurrentTick_;
+    size_t level = 0;
+    while (level + 1 < LevelCount && delta >= (uint64_t(1) << (SlotBits * (level + 1)))) {
+        ++level;
+    }
+
+    // Beyond the last level: park in the farthest slot and re-place on cascade.
+    constexpr uint64_t Horizon = uint64_t(1) << (SlotBits * LevelCount);
+    if (delta >= Horizon) {
+        deadline = CurrentTick_ + Horizon - 1;
+    }
+
+    size_t slot = (deadline >> (SlotBits * level)) & (SlotCount - 1);
+    Levels_[level].Slots[slot].push_back(std::move(entry));
+    SetOccupied(Levels_[level], slot);
+}
+
+void TTimerWheel::Cascade(size_t level, std::vector<TTimerEntryPtr>* ready) {
+    auto& source = Levels_[level];
+    size_t slot = (CurrentTick_ >> (SlotBits * level)) & (SlotCount - 1);
+
+    std::vector<TTimerEntryPtr> entries;
+    entries.swap(source.Slots[slot]);
+    ClearOccupied(source, slot);
+
+    for (auto& entry : entries) {
+        if (entry->IsCancelled()) {
+            --Size_;
+            continue;
+        }
+        // Nothing cascaded from a higher level is due before the current
+        // tick. Entries due exactly now, e.g. at a multiple of the level's
+        // span, are handed out with this tick rather than the next one.
+        Place(std::move(entry), ready);
+    }
+}
+
+void TTimerWheel::Advance(uint64_t tick, std::vector<TTimerEntryPtr>* ready) {
+    while (CurrentTick_ < tick) {
+        auto next = GetNextTick();
+        if (!next || *next > tick) {
+            CurrentTick_ = tick;
+            return;
+        }
+        CurrentTick_ = *next;
+
+        for (size_t level = LevelCount - 1; level > 0; --level) {
+            if ((CurrentTick_ & ((uint64_t(1) << (SlotBits * level)) - 1)) == 0) {
+                Cascade(level, ready);
+            }
+        }
+
+        auto& first = Levels_[0];
+        size_t slot = CurrentTick_ & (SlotCount - 1);
+        std::vector<TTimerEntryPtr> entries;
+        entries.swap(first.Slots[slot]);
+        ClearOccupied(first, slot);
+
+        for (auto& entry : entries) {
+            --Size_;
+            if (!entry->IsCancelled()) {
+                ready->push_back(std::move(entry));
+            }
+        }
+    }
+}
+
+std::optional<uint64_t> TTimerWheel::GetNextTick() const {
+    std::optional<uint64_t> result;
+    for (size_t level = 0; level < LevelCount; ++level) {
+        uint64_t base = CurrentTick_ >> (SlotBits * level);
+        size_t distance = GetNextOccupiedDistance(Levels_[level], base & (SlotCount - 1));
+        if (distance == 0) {
+            continue;
+        }
+        uint64_t tick = (base + distance) << (SlotBits * level);
+        if (!result || tick < *result) {
+            result = tick;
+        }
+    }
+    return result;
+}
+
+uint64_t TTimerWheel::GetCurrentTick() const {
+    return CurrentTick_;
+}
+
+size_t TTimerWheel::GetSize() const {
+    return Size_;
+}
+
+void TTimerWheel::SetOccupied(TLevel& level, size_t slot) {
+    level.Occupied[slot / 64] |= uint64_t(1) << (slot % 64);
+}
+
+void TTimerWheel::ClearOccupied(TLevel& level, size_t slot) {
+    level.Occupied[slot / 64] &= ~(uint64_t(1) << (slot % 64));
+}
+
+size_t TTimerWheel::GetNextOccupiedDistance(const TLevel& level, size_t position) const {
+    size_t distance = 1;
+    while (distance <= SlotCount) {
+        size_t slot = (position + distance) & (SlotCount - 1);
+        uint64_t word = level.Occupied[slot / 64] >> (slot % 64);
+        if (word != 0) {
+            return distance + __builtin_ctzll(word);
+        }
+        distance += 64 - slot % 64;
+    }
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NCommon
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <common/intrusive_ptr.h>
+#include <common/refcounted.h>
+#include <common/task.h>
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace NCommon {
+
+////////////////////////////////////////////////////////////////////////////////
+
+class TTimerEntry
+    : public NRefCounted::TRefCountedBase
+{
+public:
+    TTimerEntry(uint64_t deadlineTick, TTask callback);
+
+    uint64_t GetDeadlineTick() const;
+
+    bool IsCancelled() const;
+
+    void Cancel();
+
+    TTask ExtractCallback();
+
+private:
+    const uint64_t DeadlineTick_;
+    TTask Callback_;
+    bool Cancelled_ = false;
+};
+
+DECLARE_REFCOUNTED(TTimerEntry);
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Hierarchical timing wheel: four levels of 256 slots, each level covering 256
+// ticks of the level below. Insertion is O(1), entries are cascaded down at most
+// once per level, and per-level occupancy bitmaps give the next tick worth
+// waking up for. Not thread-safe.
+class TTimerWheel {
+public:
+    static constexpr size_t LevelCount = 4;
+    static constexpr size_t SlotBits = 8;
+    static constexpr size_t SlotCount = 1 << SlotBits;
+
+    void Insert(TTimerEntryPtr entry);
+
+    // Moves the wheel to |tick| and appends due entries to |ready|.
+    void Advance(uint64_t tick, std::vector<TTimerEntryPtr>* ready);
+
+    // Earliest tick at which Advance may produce entries or cascade them, or
+    // nullopt if the wheel is empty.
+    std::optional<uint64_t> GetNextTick() const;
+
+    uint64_t GetCurrentTick() const;
+
+    size_t GetSize() const;
+
+private:
+    struct TLevel {
+        std::array<std::vector<TTimerEntryPtr>, SlotCount> Slots;
+        std::array<uint64_t, SlotCount / 64> Occupied{};
+    };
+
+    void Place(TTimerEntryPtr entry, std::vector<TTimerEntryPtr>* ready);
+    // Entries due at the current tick go to |ready| right away.
+    void Cascade(size_t level, std::vector<TTimerEntryPtr>* ready);
+
+    void SetOccupied(TLevel& level, size_t slot);
+    void ClearOccupied(TLevel& level, size_t slot);
+
+    // Distance in slots (1..SlotCount) from |position| to the next occupied
+    // slot of |level|, or 0 if the level is empty.
+    size_t GetNextOccupiedDistance(const TLevel& level, size_t position) const;
+
+    std::array<TLevel, LevelCount> Levels_;
+    uint64_t CurrentTick_ = 0;
+    size_t Size_ = 0;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NCommon
@@ -0,0 +1,141 @@
+#include <tests/harness.h>
+
+#include <common/atomic_intrusive_ptr.h>
+#include <common/exception.h>
+#include <common/refcounted.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace NTest {
+
+using namespace NCommon;
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+std::atomic<int> AliveCount{0};
+
+class TTracked
+    : public NRefCounted::TRefCountedBase
+{
+public:
+    static constexpr int LiveMagic = 0x600d;
+
+    explicit TTracked(int value = 0)
+        : Value(value)
+    {
+        AliveCount.fetch_add(1);
+    }
+
+    ~TTracked() {
+        Magic = 0;
+        AliveCount.fetch_sub(1);
+    }
+
+    const int Value;
+    // Cleared on destruction, so that a reader can tell it got a dead object.
+    std::atomic<int> Magic{LiveMagic};
+};
+
+void StoreExchangeAndCompareAndSwap() {
+    AliveCount = 0;
+    {
+        TAtomicIntrusivePtr<TTracked> holder(New<TTracked>(1));
+        ASSERT(holder.Acquire()->Value == 1, "Acquire returned {}", holder.Acquire()->Value);
+
+        auto previous = holder.Exchange(New<TTracked>(2));
+        ASSERT(previous->Value == 1, "Exchange returned {}", previous->Value);
+        previous.reset();
+        ASSERT(AliveCount == 1, "{} objects alive after dropping the exchanged one", AliveCount.load());
+
+        auto expected = New<TTracked>(3);
+        ASSERT(!holder.CompareAndSwap(expected, New<TTracked>(4)), "CompareAndSwap with a stale value succeeded");
+        ASSERT(expected->Value == 2, "failed CompareAndSwap reloaded {}", expected->Value);
+        ASSERT(holder.CompareAndSwap(expected, New<TTracked>(5)), "CompareAndSwap with the current value failed");
+        ASSERT(holder.Acquire()->Value == 5, "CompareAndSwap stored {}", holder.Acquire()->Value);
+
+        expected.reset();
+        holder.Reset();
+        ASSERT(!holder, "holder is set after Reset");
+        ASSERT(AliveCount == 0, "{} objects alive after Reset", AliveCount.load());
+
+        holder.Store(New<TTracked>(6));
+    }
+    ASSERT(AliveCount == 0, "holder destruction leaked {} objects", AliveCount.load());
+}
+
+// A replaced value outlives the guards reading it and is reclaimed as soon as
+// the last of them goes, not on some later retirement.
+void GuardDefersReclaim() {
+    AliveCount = 0;
+    TAtomicIntrusivePtr<TTracked> holder(New<TTracked>(1));
+    {
+        auto guard = holder.Read();
+        holder.Store(New<TTracked>(2));
+        ASSERT(AliveCount == 2, "guarded value was reclaimed, {} alive", AliveCount.load());
+        ASSERT(guard->Value == 1 && guard->Magic == TTracked::LiveMagic, "guard sees a dead value");
+    }
+    ASSERT(AliveCount == 1, "releasing the last guard left {} alive", AliveCount.load());
+}
+
+void ConcurrentReadersAndWriters() {
+    constexpr int ReaderCount = 3;
+    constexpr int WriteCount = 20000;
+
+    AliveCount = 0;
+    {
+        TAtomicIntrusivePtr<TTracked> holder(New<TTracked>(0));
+        std::atomic<bool> stop{false};
+        std::atomic<int> deadReads{0};
+
+        std::vector<std::thread> readers;
+        for (int index = 0; index < ReaderCount; ++index) {
+            readers.emplace_back([&, index] {
+                while (!stop.load()) {
+                    if (index % 2 == 0) {
+                        auto guard = holder.Read();
+                        if (guard->Magic != TTracked::LiveMagic) {
+                            deadReads.fetch_add(1);
+                        }
+                    } else {
+                        auto value = holder.Acquire();
+                        if (value->Magic != TTracked::LiveMagic) {
+                            deadReads.fetch_add(1);
+                        }
+                    }
+                }
+            });
+        }
+
+        for (int index = 1; index <= WriteCount; ++index) {
+            if (index % 2 == 0) {
+                holder.Store(New<TTracked>(index));
+            } else {
+                holder.Exchange(New<TTracked>(index));
+            }
+        }
+        stop = true;
+        for (auto& reader : readers) {
+            reader.join();
+        }
+
+        ASSERT(deadReads == 0, "{} reads saw a reclaimed value", deadReads.load());
+        ASSERT(AliveCount == 1, "{} objects alive with the readers gone", AliveCount.load());
+    }
+    ASSERT(AliveCount == 0, "{} objects leaked", AliveCount.load());
+}
+
+} // namespace
+
+void RegisterAtomicIntrusivePtrTests(TTestRunner& runner) {
+    runner.Register("atomic_intrusive_ptr/store_exchange_and_compare_and_swap", StoreExchangeAndCompareAndSwap);
+    runner.Register("atomic_intrusive_ptr/guard_defers_reclaim", GuardDefersReclaim);
+    runner.Register("atomic_intrusive_ptr/concurrent_readers_and_writers", ConcurrentReadersAndWriters);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NTest
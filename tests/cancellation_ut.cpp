@@ -0,0 +1,116 @@
+#include <tests/harness.h>
+
+#include <common/cancellation.h>
+#include <common/exception.h>
+#include <common/latch.h>
+#include <common/threadpool.h>
+
+#include <atomic>
+
+namespace NTest {
+
+using namespace NCommon;
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+template <typename T>
+EErrorCode GetErrorCode(const TFuture<T>& future) {
+    const auto& result = future.Get();
+    ASSERT(!result, "future succeeded instead of failing");
+    return result.Error().GetCode();
+}
+
+void CancelledTokenSkipsTask() {
+    auto invoker = New<TInvoker>(New<TThreadPool>(1));
+    TCancellationSource source;
+    source.Cancel();
+
+    std::atomic<bool> ran{false};
+    auto future = invoker->Run(source.GetToken(), [&] {
+        ran = true;
+    });
+    ASSERT(GetErrorCode(future) == EErrorCode::Cancelled, "task with a cancelled token did not fail as cancelled");
+    ASSERT(!ran, "task with a cancelled token ran");
+}
+
+// Cancelling a queued task resolves its future right away, without waiting
+// for a worker to reach it.
+void CancelWhileQueued() {
+    auto invoker = New<TInvoker>(New<TThreadPool>(1));
+    TCountDownLatch gate(1);
+    invoker->Invoke([&] {
+        gate.Wait();
+    });
+
+    TCancellationSource source;
+    std::atomic<bool> ran{false};
+    auto future = invoker->Run(source.GetToken(), [&] {
+        ran = true;
+        return 1;
+    });
+    ASSERT(!future.IsSet(), "queued task resolved early");
+    source.Cancel();
+    ASSERT(future.IsSet(), "cancellation did not resolve the queued task");
+    ASSERT(GetErrorCode(future) == EErrorCode::Cancelled, "queued task did not fail as cancelled");
+
+    gate.CountDown();
+    invoker->Run([] {}).Get().ThrowOnError();
+    ASSERT(!ran, "cancelled task ran once the worker got to it");
+}
+
+// A task shed by the pool releases its subscription; cancelling the token
+// afterwards leaves the resolved future alone.
+void ShedTaskWithToken() {
+    TThreadPoolOptions options;
+    options.MaxQueuedTasks = 1;
+    options.OverflowPolicy = EOverflowPolicy::Fail;
+    auto invoker = New<TInvoker>(New<TThreadPool>(1, options));
+
+    TCountDownLatch gate(1);
+    TCountDownLatch started(1);
+    invoker->Invoke([&] {
+        started.CountDown();
+        gate.Wait();
+    });
+    started.Wait();
+    auto queued = invoker->Run([] {
+        return 1;
+    });
+
+    TCancellationSource source;
+    auto shed = invoker->Run(source.GetToken(), [] {
+        return 2;
+    });
+    ASSERT(GetErrorCode(shed) == EErrorCode::Overloaded, "task over the queue bound was not shed");
+    source.Cancel();
+    ASSERT(GetErrorCode(shed) == EErrorCode::Overloaded, "cancellation overwrote the shed result");
+
+    gate.CountDown();
+    ASSERT(queued.Get().ValueOrThrow() == 1, "queued task returned {}", queued.Get().Value());
+}
+
+void RunsWithLiveToken() {
+    auto invoker = New<TInvoker>(New<TThreadPool>(2));
+    TCancellationSource source;
+    for (int index = 0; index < 1000; ++index) {
+        auto future = invoker->Run(source.GetToken(), [index] {
+            return index;
+        });
+        ASSERT(future.Get().ValueOrThrow() == index, "task {} returned {}", index, future.Get().Value());
+    }
+}
+
+} // namespace
+
+void RegisterCancellationTests(TTestRunner& runner) {
+    runner.Register("cancellation/cancelled_token_skips_task", CancelledTokenSkipsTask);
+    runner.Register("cancellation/cancel_while_queued", CancelWhileQueued);
+    runner.Register("cancellation/shed_task_with_token", ShedTaskWithToken);
+    runner.Register("cancellation/runs_with_live_token", RunsWithLiveToken);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NTest
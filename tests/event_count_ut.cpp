@@ -0,0 +1,146 @@
+#include <tests/harness.h>
+
+#include <common/event_count.h>
+#include <common/exception.h>
+#include <common/latch.h>
+#include <common/threadpool.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+namespace NTest {
+
+using namespace NCommon;
+using namespace std::chrono_literals;
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+void CountsWaiters() {
+    TEventCount eventCount;
+    ASSERT(eventCount.GetWaiterCount() == 0, "{} waiters at start", eventCount.GetWaiterCount());
+
+    eventCount.PrepareWait();
+    ASSERT(eventCount.GetWaiterCount() == 1, "{} waiters after PrepareWait", eventCount.GetWaiterCount());
+    eventCount.CancelWait();
+    ASSERT(eventCount.GetWaiterCount() == 0, "{} waiters after CancelWait", eventCount.GetWaiterCount());
+
+    auto key = eventCount.PrepareWait();
+    ASSERT(!eventCount.WaitFor(key, 1ms), "WaitFor without a notification succeeded");
+    ASSERT(eventCount.GetWaiterCount() == 0, "{} waiters after a timeout", eventCount.GetWaiterCount());
+}
+
+// A notification between PrepareWait and Wait is not lost.
+void NotifyBeforeWait() {
+    TEventCount eventCount;
+    auto key = eventCount.PrepareWait();
+    eventCount.NotifyOne();
+    ASSERT(eventCount.WaitFor(key, 10s), "notification before the wait was lost");
+}
+
+// Hands a token back and forth; a lost wakeup leaves both threads waiting.
+void PingPong() {
+    constexpr int RoundCount = 20000;
+
+    TEventCount eventCount;
+    std::atomic<int> turn{0};
+
+    auto play = [&] (int parity) {
+        for (int round = parity; round < RoundCount; round += 2) {
+            while (turn.load() != round) {
+                auto key = eventCount.PrepareWait();
+                if (turn.load() == round) {
+                    eventCount.CancelWait();
+                    break;
+                }
+                eventCount.Wait(key);
+            }
+            turn.store(round + 1);
+            eventCount.NotifyAll();
+        }
+    };
+
+    std::thread other(play, 1);
+    play(0);
+    other.join();
+    ASSERT(turn.load() == RoundCount, "stopped at round {}", turn.load());
+}
+
+void NotifyAllWakesEveryWaiter() {
+    constexpr int WaiterCount = 4;
+
+    TEventCount eventCount;
+    std::atomic<bool> ready{false};
+    std::atomic<int> woken{0};
+
+    std::vector<std::thread> waiters;
+    for (int index = 0; index < WaiterCount; ++index) {
+        waiters.emplace_back([&] {
+            while (!ready.load()) {
+                auto key = eventCount.PrepareWait();
+                if (ready.load()) {
+                    eventCount.CancelWait();
+                    break;
+                }
+                eventCount.Wait(key);
+            }
+            woken.fetch_add(1);
+        });
+    }
+    while (eventCount.GetWaiterCount() < WaiterCount) {
+        std::this_thread::yield();
+    }
+    ready.store(true);
+    eventCount.NotifyAll();
+    for (auto& waiter : waiters) {
+        waiter.join();
+    }
+    ASSERT(woken.load() == WaiterCount, "{} of {} waiters woke up", woken.load(), WaiterCount);
+}
+
+// Bursts separated by pauses, so that the workers go through the whole
+// spin, yield and park sequence between them.
+void RunBursts(const TThreadPoolOptions& options) {
+    auto invoker = New<TInvoker>(New<TThreadPool>(2, options));
+    for (int burst = 0; burst < 20; ++burst) {
+        TCountDownLatch done(100);
+        for (int index = 0; index < 100; ++index) {
+            invoker->Invoke([&] {
+                done.CountDown();
+            });
+        }
+        done.Wait();
+        std::this_thread::sleep_for(1ms);
+    }
+}
+
+void ThreadPoolIdlePolicies() {
+    TThreadPoolOptions parkRightAway;
+    RunBursts(parkRightAway);
+
+    TThreadPoolOptions spinThenPark;
+    spinThenPark.IdleSpinIterations = 1000;
+    spinThenPark.IdleYieldIterations = 10;
+    RunBursts(spinThenPark);
+
+    TThreadPoolOptions lockFree = spinThenPark;
+    lockFree.Backend = EQueueBackend::LockFree;
+    RunBursts(lockFree);
+}
+
+} // namespace
+
+void RegisterEventCountTests(TTestRunner& runner) {
+    runner.Register("event_count/counts_waiters", CountsWaiters);
+    runner.Register("event_count/notify_before_wait", NotifyBeforeWait);
+    runner.Register("event_count/ping_pong", PingPong);
+    runner.Register("event_count/notify_all_wakes_every_waiter", NotifyAllWakesEveryWaiter);
+    runner.Register("event_count/thread_pool_idle_policies", ThreadPoolIdlePolicies);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NTest
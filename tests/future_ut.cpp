@@ -0,0 +1,272 @@
+#include <tests/harness.h>
+
+#include <common/coroutine.h>
+#include <common/exception.h>
+#include <common/future.h>
+#include <common/latch.h>
+#include <common/threadpool.h>
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace NTest {
+
+using namespace NCommon;
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+// Counts its copies, so that tests can tell a copy of a value from a move.
+struct TCopyCounted {
+    static inline std::atomic<int> Copies{0};
+
+    int Value = 0;
+
+    explicit TCopyCounted(int value)
+        : Value(value)
+    { }
+
+    TCopyCounted(const TCopyCounted& other)
+        : Value(other.Value)
+    {
+        Copies.fetch_add(1);
+    }
+
+    TCopyCounted(TCopyCounted&&) = default;
+
+    TCopyCounted& operator=(const TCopyCounted& other) {
+        Value = other.Value;
+        Copies.fetch_add(1);
+        return *this;
+    }
+
+    TCopyCounted& operator=(TCopyCounted&&) = default;
+};
+
+void SetAndSubscribe() {
+    auto promise = NewPromise<int>();
+    auto future = promise.ToFuture();
+    ASSERT(!future.IsSet(), "future is set before its promise");
+    ASSERT(!future.TryGet(), "TryGet returned a value before the promise was set");
+
+    int early = 0;
+    future.Subscribe([&] (const TErrorOr<int>& result) {
+        early = result.Value();
+    });
+    promise.Set(42);
+    ASSERT(early == 42, "subscriber saw {} instead of 42", early);
+    ASSERT(!promise.TrySet(43), "second TrySet succeeded");
+
+    int late = 0;
+    future.Subscribe([&] (const TErrorOr<int>& result) {
+        late = result.Value();
+    });
+    ASSERT(late == 42, "late subscriber saw {} instead of 42", late);
+    ASSERT(future.Get().Value() == 42, "Get returned {} instead of 42", future.Get().Value());
+}
+
+void ApplyChainsValuesAndErrors() {
+    auto promise = NewPromise<int>();
+    auto doubled = promise.ToFuture().Apply([] (int value) {
+        return value * 2;
+    });
+    auto described = doubled.Apply([] (const TErrorOr<int>& result) {
+        return result ? std::to_string(result.Value()) : std::string("error");
+    });
+    auto unwrapped = doubled.Apply([] (int value) {
+        return MakeFuture(TErrorOr<int>(value + 1));
+    });
+    promise.Set(21);
+
+    ASSERT(doubled.Get().Value() == 42, "value callback returned {}", doubled.Get().Value());
+    ASSERT(described.Get().Value() == "42", "TErrorOr callback returned {}", described.Get().Value());
+    ASSERT(unwrapped.Get().Value() == 43, "returned future unwrapped to {}", unwrapped.Get().Value());
+
+    bool called = false;
+    auto failed = MakeFuture(TErrorOr<int>(TException("boom"))).Apply([&] (int value) {
+        called = true;
+        return value;
+    });
+    ASSERT(!called, "value callback ran on an error");
+    ASSERT(!failed.Get(), "error was not propagated");
+
+    auto thrown = MakeFuture(TErrorOr<int>(1)).Apply([] (int) -> int {
+        throw TException("thrown");
+    });
+    ASSERT(!thrown.Get(), "exception of the callback was not turned into an error");
+    ASSERT(std::string(thrown.Get().Error().what()).find("thrown") != std::string::npos,
+        "unexpected error: {}", thrown.Get().Error().what());
+}
+
+void ApplyOnInvoker() {
+    auto pool = New<TThreadPool>(1);
+    auto invoker = New<TInvoker>(pool);
+
+    auto promise = NewPromise<int>();
+    auto future = promise.ToFuture().Apply(invoker, [pool] (int value) {
+        ASSERT(pool->IsWorkerThread(), "continuation did not run on the invoker");
+        return value + 1;
+    });
+    promise.Set(1);
+    ASSERT(future.Get().ValueOrThrow() == 2, "continuation returned {}", future.Get().Value());
+}
+
+// The continuation is stored in the source state, so it must not keep that
+// state alive: a promise that is dropped without being set has to release
+// the state together with the callback and everything it captured.
+void ApplyOnInvokerReleasesAbandonedState() {
+    auto invoker = New<TInvoker>(New<TThreadPool>(1));
+
+    auto captured = std::make_shared<int>(0);
+    std::weak_ptr<int> weak = captured;
+    {
+        auto promise = NewPromise<int>();
+        auto future = promise.ToFuture().Apply(invoker, [captured = std::move(captured)] (int value) {
+            return value + *captured;
+        });
+    }
+    ASSERT(weak.expired(), "abandoned continuation was leaked");
+}
+
+void RunOnInvoker() {
+    auto invoker = New<TInvoker>(New<TThreadPool>(2));
+
+    auto sum = invoker->Run([] (int left, int right) {
+        return left + right;
+    }, 2, 3);
+    ASSERT(sum.Get().ValueOrThrow() == 5, "Run returned {}", sum.Get().Value());
+
+    auto failed = invoker->Run([] () -> int {
+        throw TException("failed task");
+    });
+    ASSERT(!failed.Get(), "exception of the task was not turned into an error");
+
+    std::atomic<bool> ran{false};
+    invoker->Run([&] {
+        ran = true;
+    }).Get().ThrowOnError();
+    ASSERT(ran.load(), "void task did not run");
+}
+
+void AllOfAndAnyOf() {
+    std::vector<TPromise<int>> promises;
+    std::vector<TFuture<int>> futures;
+    for (int index = 0; index < 3; ++index) {
+        promises.push_back(NewPromise<int>());
+        futures.push_back(promises.back().ToFuture());
+    }
+
+    auto all = AllOf(futures);
+    auto any = AnyOf(futures);
+    promises[2].Set(TErrorOr<int>(TException("first failure")));
+    ASSERT(!any.IsSet(), "AnyOf resolved on an error while others are pending");
+    promises[1].Set(20);
+    ASSERT(any.Get().Value() == 20, "AnyOf resolved with {}", any.Get().Value());
+    ASSERT(!all.Get(), "AllOf did not fail with the first error");
+    promises[0].Set(10);
+
+    auto values = AllOf(std::vector<TFuture<int>>{MakeFuture(TErrorOr<int>(1)), MakeFuture(TErrorOr<int>(2))});
+    const auto& result = values.Get().ValueOrThrow();
+    ASSERT(result == std::vector<int>({1, 2}), "AllOf lost the order of the values");
+
+    auto failures = AnyOf(std::vector<TFuture<int>>{
+        MakeFuture(TErrorOr<int>(TException("one"))),
+        MakeFuture(TErrorOr<int>(TException("two"))),
+    });
+    ASSERT(!failures.Get(), "AnyOf of failures succeeded");
+}
+
+void ErrorOrAccessDoesNotCopy() {
+    TCopyCounted::Copies = 0;
+
+    TErrorOr<TCopyCounted> result(std::in_place, 1);
+    ASSERT(result.Value().Value == 1 && result.ValueOrThrow().Value == 1, "lost the value");
+    auto mapped = std::move(result).Map([] (TCopyCounted&& value) {
+        return TCopyCounted(value.Value + 1);
+    });
+    auto moved = std::move(mapped).ValueOrThrow();
+    ASSERT(moved.Value == 2, "mapped to {}", moved.Value);
+    ASSERT(TCopyCounted::Copies == 0, "{} copies on access", TCopyCounted::Copies.load());
+}
+
+void ExtractMovesUniqueValue() {
+    TCopyCounted::Copies = 0;
+    auto unique = MakeFuture(TErrorOr<TCopyCounted>(std::in_place, 1));
+    auto extracted = std::move(unique).Extract();
+    ASSERT(!unique, "Extract left the future set");
+    ASSERT(extracted.Value().Value == 1, "extracted {}", extracted.Value().Value);
+    ASSERT(TCopyCounted::Copies == 0, "{} copies extracting a unique value", TCopyCounted::Copies.load());
+
+    // Another holder keeps its value.
+    auto shared = MakeFuture(TErrorOr<TCopyCounted>(std::in_place, 2));
+    auto other = shared;
+    auto copied = std::move(shared).Extract();
+    ASSERT(copied.Value().Value == 2 && other.Get().Value().Value == 2, "shared value was not copied");
+    ASSERT(TCopyCounted::Copies == 1, "{} copies extracting a shared value", TCopyCounted::Copies.load());
+}
+
+void AllOfMovesValues() {
+    constexpr int Count = 100;
+
+    TCopyCounted::Copies = 0;
+    std::vector<TPromise<TCopyCounted>> promises;
+    std::vector<TFuture<TCopyCounted>> futures;
+    for (int index = 0; index < Count; ++index) {
+        promises.push_back(NewPromise<TCopyCounted>());
+        futures.push_back(promises.back().ToFuture());
+    }
+    auto pending = AllOf(std::move(futures));
+    for (auto& promise : promises) {
+        // Dropped once set; only the promise setting the last value still
+        // shares its state when the values are taken.
+        std::exchange(promise, {}).Set(TErrorOr<TCopyCounted>(std::in_place, 1));
+    }
+    ASSERT(pending.Get().Value().size() == Count, "AllOf returned {} values", pending.Get().Value().size());
+    ASSERT(TCopyCounted::Copies <= 1, "{} copies joining pending futures", TCopyCounted::Copies.load());
+
+    TCopyCounted::Copies = 0;
+    std::vector<TFuture<TCopyCounted>> ready;
+    for (int index = 0; index < Count; ++index) {
+        ready.push_back(MakeFuture(TErrorOr<TCopyCounted>(std::in_place, index)));
+    }
+    auto joined = AllOf(std::move(ready));
+    ASSERT(joined.Get().Value().size() == Count, "AllOf returned {} values", joined.Get().Value().size());
+    ASSERT(TCopyCounted::Copies <= 1, "{} copies joining ready futures", TCopyCounted::Copies.load());
+}
+
+TCoroutine<int> AwaitTemporary() {
+    auto result = co_await MakeFuture(TErrorOr<TCopyCounted>(std::in_place, 7));
+    co_return result.Value().Value;
+}
+
+void AwaitMovesValue() {
+    auto invoker = New<TInvoker>(New<TThreadPool>(1));
+
+    TCopyCounted::Copies = 0;
+    int value = AwaitTemporary().Start(invoker).Get().ValueOrThrow();
+    ASSERT(value == 7, "coroutine returned {}", value);
+    ASSERT(TCopyCounted::Copies == 0, "{} copies awaiting a temporary future", TCopyCounted::Copies.load());
+}
+
+} // namespace
+
+void RegisterFutureTests(TTestRunner& runner) {
+    runner.Register("future/set_and_subscribe", SetAndSubscribe);
+    runner.Register("future/apply_chains_values_and_errors", ApplyChainsValuesAndErrors);
+    runner.Register("future/apply_on_invoker", ApplyOnInvoker);
+    runner.Register("future/apply_on_invoker_releases_abandoned_state", ApplyOnInvokerReleasesAbandonedState);
+    runner.Register("future/run_on_invoker", RunOnInvoker);
+    runner.Register("future/all_of_and_any_of", AllOfAndAnyOf);
+    runner.Register("future/error_or_access_does_not_copy", ErrorOrAccessDoesNotCopy);
+    runner.Register("future/extract_moves_unique_value", ExtractMovesUniqueValue);
+    runner.Register("future/all_of_moves_values", AllOfMovesValues);
+    runner.Register("future/await_moves_value", AwaitMovesValue);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NTest
@@ -0,0 +1,53 @@
+#include <tests/harness.h>
+
+#include <chrono>
+#include <exception>
+
+namespace NTest {
+
+////////////////////////////////////////////////////////////////////////////////
+
+void TTestRunner::Register(std::string name, TTestBody body) {
+    Tests_.push_back({std::move(name), std::move(body)});
+}
+
+size_t TTestRunner::Run(const std::string& filter, std::ostream& out) const {
+    size_t matched = 0;
+    size_t failed = 0;
+    for (const auto& test : Tests_) {
+        if (test.Name.find(filter) == std::string::npos) {
+            continue;
+        }
+        ++matched;
+
+        auto start = std::chrono::steady_clock::now();
+        std::string error;
+        try {
+            test.Body();
+        } catch (const std::exception& ex) {
+            error = ex.what();
+        } catch (...) {
+            error = "unknown exception";
+        }
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start);
+
+        if (error.empty()) {
+            out << "[  OK  ] " << test.Name << " (" << elapsed.count() << " ms)" << std::endl;
+        } else {
+            ++failed;
+            out << "[ FAIL ] " << test.Name << " (" << elapsed.count() << " ms)\n" << error << std::endl;
+        }
+    }
+
+    if (matched == 0) {
+        out << "No test matches \"" << filter << "\"" << std::endl;
+        return 1;
+    }
+    out << matched - failed << " of " << matched << " tests passed" << std::endl;
+    return failed;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NTest
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace NTest {
+
+////////////////////////////////////////////////////////////////////////////////
+
+// A test fails by throwing, normally through ASSERT from common/exception.h.
+using TTestBody = std::function<void()>;
+
+// Minimal test harness: tests run one after another in registration order,
+// each reported on a line of its own.
+class TTestRunner {
+public:
+    void Register(std::string name, TTestBody body);
+
+    // Runs tests whose name contains |filter| and returns the number of
+    // failures; fails as well if no test matches.
+    size_t Run(const std::string& filter, std::ostream& out) const;
+
+private:
+    struct TTest {
+        std::string Name;
+        TTestBody Body;
+    };
+
+    std::vector<TTest> Tests_;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Test sets, registered by main. Names are "<set>/<test>", and CTest runs
+// every set as a test of its own.
+void RegisterMpmcQueueTests(TTestRunner& runner);
+void RegisterFutureTests(TTestRunner& runner);
+void RegisterTimerWheelTests(TTestRunner& runner);
+void RegisterSerializedInvokerTests(TTestRunner& runner);
+void RegisterEventCountTests(TTestRunner& runner);
+void RegisterAtomicIntrusivePtrTests(TTestRunner& runner);
+void RegisterCancellationTests(TTestRunner& runner);
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NTest
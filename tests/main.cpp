@@ -0,0 +1,51 @@
+#include <tests/harness.h>
+
+#include <common/getopts.h>
+
+#include <iostream>
+
+using namespace NTest;
+
+////////////////////////////////////////////////////////////////////////////////
+
+class TTestOpts
+    : public NCommon::GetOpts
+{
+public:
+    std::string Filter;
+
+    void Register() override {
+        SetDescription("Tests of the common library.");
+        AddExample("common_tests --filter future/");
+
+        AddOption('f', "filter", &Filter)
+            .Help("Run only tests whose name contains this string")
+            .Default("");
+    }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, const char* argv[]) {
+    TTestOpts opts;
+    try {
+        opts.Parse(argc, argv);
+    } catch (const std::exception& ex) {
+        std::cerr << ex.what() << std::endl;
+        return 1;
+    }
+    if (opts.IsVersionOrHelp()) {
+        return 0;
+    }
+
+    TTestRunner runner;
+    RegisterMpmcQueueTests(runner);
+    RegisterFutureTests(runner);
+    RegisterTimerWheelTests(runner);
+    RegisterSerializedInvokerTests(runner);
+    RegisterEventCountTests(runner);
+    RegisterAtomicIntrusivePtrTests(runner);
+    RegisterCancellationTests(runner);
+
+    return runner.Run(opts.Filter, std::cout) == 0 ? 0 : 1;
+}
@@ -0,0 +1,135 @@
+#include <tests/harness.h>
+
+#include <common/exception.h>
+#include <common/latch.h>
+#include <common/mpmc_queue.h>
+#include <common/threadpool.h>
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace NTest {
+
+using namespace NCommon;
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+void FifoAndCapacity() {
+    TBoundedMpmcQueue<std::unique_ptr<int>> queue(5);
+    ASSERT(queue.Capacity() == 8, "capacity {} is not rounded up to 8", queue.Capacity());
+    ASSERT(queue.Empty(), "new queue is not empty");
+
+    for (int index = 0; index < 8; ++index) {
+        ASSERT(queue.TryPush(std::make_unique<int>(index)), "push {} failed", index);
+    }
+    auto rejected = std::make_unique<int>(8);
+    ASSERT(!queue.TryPush(std::move(rejected)), "push into a full queue succeeded");
+    ASSERT(rejected && *rejected == 8, "rejected push consumed its value");
+    ASSERT(queue.SizeApprox() == 8, "size {} instead of 8", queue.SizeApprox());
+
+    std::unique_ptr<int> value;
+    for (int index = 0; index < 8; ++index) {
+        ASSERT(queue.TryPop(value), "pop {} failed", index);
+        ASSERT(*value == index, "popped {} instead of {}", *value, index);
+    }
+    ASSERT(!queue.TryPop(value), "pop from an empty queue succeeded");
+
+    // The positions wrap around the ring.
+    for (int index = 0; index < 100; ++index) {
+        ASSERT(queue.TryPush(std::make_unique<int>(index)), "push {} after wrapping failed", index);
+        ASSERT(queue.TryPop(value) && *value == index, "pop {} after wrapping failed", index);
+    }
+}
+
+void DestroysRemainingValues() {
+    auto value = std::make_shared<int>(0);
+    {
+        TBoundedMpmcQueue<std::shared_ptr<int>> queue(4);
+        for (int index = 0; index < 3; ++index) {
+            auto copy = value;
+            ASSERT(queue.TryPush(std::move(copy)), "push {} failed", index);
+        }
+        ASSERT(value.use_count() == 4, "use count {} instead of 4", value.use_count());
+    }
+    ASSERT(value.use_count() == 1, "queue leaked {} values", value.use_count() - 1);
+}
+
+void ConcurrentProducersAndConsumers() {
+    constexpr int ThreadCount = 4;
+    constexpr int ValuesPerProducer = 20000;
+
+    TBoundedMpmcQueue<int> queue(64);
+    std::vector<std::atomic<int>> seen(ThreadCount * ValuesPerProducer);
+    std::atomic<int> popped{0};
+
+    std::vector<std::thread> threads;
+    for (int producer = 0; producer < ThreadCount; ++producer) {
+        threads.emplace_back([&, producer] {
+            for (int index = 0; index < ValuesPerProducer; ++index) {
+                int value = producer * ValuesPerProducer + index;
+                while (!queue.TryPush(std::move(value))) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (int consumer = 0; consumer < ThreadCount; ++consumer) {
+        threads.emplace_back([&] {
+            int value;
+            while (popped.load() < ThreadCount * ValuesPerProducer) {
+                if (queue.TryPop(value)) {
+                    seen[value].fetch_add(1);
+                    popped.fetch_add(1);
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    for (size_t value = 0; value < seen.size(); ++value) {
+        ASSERT(seen[value].load() == 1, "value {} popped {} times", value, seen[value].load());
+    }
+    ASSERT(queue.Empty(), "queue is not empty after all values were popped");
+}
+
+void ThreadPoolBackend() {
+    constexpr int TaskCount = 10000;
+
+    TThreadPoolOptions options;
+    options.Backend = EQueueBackend::LockFree;
+    // Small enough for the pool to fill it up.
+    options.QueueCapacity = 16;
+    auto invoker = New<TInvoker>(New<TThreadPool>(2, options));
+
+    std::atomic<int> done{0};
+    TCountDownLatch latch(TaskCount);
+    for (int index = 0; index < TaskCount; ++index) {
+        invoker->Invoke([&] {
+            done.fetch_add(1);
+            latch.CountDown();
+        });
+    }
+    latch.Wait();
+    ASSERT(done.load() == TaskCount, "{} of {} tasks ran", done.load(), TaskCount);
+}
+
+} // namespace
+
+void RegisterMpmcQueueTests(TTestRunner& runner) {
+    runner.Register("mpmc_queue/fifo_and_capacity", FifoAndCapacity);
+    runner.Register("mpmc_queue/destroys_remaining_values", DestroysRemainingValues);
+    runner.Register("mpmc_queue/concurrent_producers_and_consumers", ConcurrentProducersAndConsumers);
+    runner.Register("mpmc_queue/thread_pool_backend", ThreadPoolBackend);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NTest
@@ -0,0 +1,147 @@
+#include <tests/harness.h>
+
+#include <common/exception.h>
+#include <common/latch.h>
+#include <common/serialized_invoker.h>
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace NTest {
+
+using namespace NCommon;
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+void KeepsOrderAndExclusion() {
+    constexpr int ProducerCount = 4;
+    constexpr int TasksPerProducer = 20000;
+
+    auto invoker = New<TSerializedInvoker>(New<TInvoker>(New<TThreadPool>(4)));
+    ASSERT(!invoker->IsCurrent(), "IsCurrent outside of a callback");
+
+    TCountDownLatch done(ProducerCount * TasksPerProducer);
+    // Touched from the callbacks only, so the strand is the only guard.
+    std::vector<int> last(ProducerCount, -1);
+    std::atomic<int> running{0};
+    std::atomic<int> outOfOrder{0};
+    std::atomic<int> overlapping{0};
+    std::atomic<int> notCurrent{0};
+
+    std::vector<std::thread> producers;
+    for (int producer = 0; producer < ProducerCount; ++producer) {
+        producers.emplace_back([&, producer] {
+            for (int index = 0; index < TasksPerProducer; ++index) {
+                invoker->Invoke([&, producer, index] {
+                    if (running.fetch_add(1) != 0) {
+                        overlapping.fetch_add(1);
+                    }
+                    if (!invoker->IsCurrent()) {
+                        notCurrent.fetch_add(1);
+                    }
+                    if (last[producer] != index - 1) {
+                        outOfOrder.fetch_add(1);
+                    }
+                    last[producer] = index;
+                    running.fetch_sub(1);
+                    done.CountDown();
+                });
+            }
+        });
+    }
+    for (auto& producer : producers) {
+        producer.join();
+    }
+    done.Wait();
+
+    ASSERT(overlapping.load() == 0, "{} callbacks ran concurrently with another", overlapping.load());
+    ASSERT(outOfOrder.load() == 0, "{} callbacks ran out of submission order", outOfOrder.load());
+    ASSERT(notCurrent.load() == 0, "IsCurrent was false in {} callbacks", notCurrent.load());
+}
+
+// A drain runs at most maxTasksPerDrain callbacks before it lets other tasks
+// of the underlying pool through.
+void YieldsAfterDrainBatch() {
+    auto underlying = New<TInvoker>(New<TThreadPool>(1));
+    auto invoker = New<TSerializedInvoker>(underlying, /*maxTasksPerDrain*/ 2);
+
+    std::mutex mutex;
+    std::vector<std::string> order;
+    auto record = [&] (std::string name) {
+        std::lock_guard<std::mutex> lock(mutex);
+        order.push_back(std::move(name));
+    };
+
+    // Holds the only worker until everything is queued.
+    TCountDownLatch gate(1);
+    underlying->Invoke([&] {
+        gate.Wait();
+    });
+    TCountDownLatch done(5);
+    for (int index = 0; index < 4; ++index) {
+        invoker->Invoke([&, index] {
+            record("serialized" + std::to_string(index));
+            done.CountDown();
+        });
+    }
+    underlying->Invoke([&] {
+        record("other");
+        done.CountDown();
+    });
+    gate.CountDown();
+    done.Wait();
+
+    const std::vector<std::string> expected = {"serialized0", "serialized1", "other", "serialized2", "serialized3"};
+    ASSERT(order == expected, "drain did not yield to the pool after 2 callbacks");
+}
+
+void RunReturnsFuture() {
+    auto invoker = New<TSerializedInvoker>(New<TInvoker>(New<TThreadPool>(2)));
+
+    std::vector<TFuture<int>> futures;
+    for (int index = 0; index < 100; ++index) {
+        futures.push_back(invoker->Run([invoker, index] {
+            ASSERT(invoker->IsCurrent(), "task {} is not on the strand", index);
+            return index;
+        }));
+    }
+    for (int index = 0; index < 100; ++index) {
+        int value = futures[index].Get().ValueOrThrow();
+        ASSERT(value == index, "future {} resolved with {}", index, value);
+    }
+}
+
+// Pending drains keep the strand and its pool alive, so dropping every other
+// reference leaves the pool to be destroyed on its own worker.
+void OutlivesItsOwner() {
+    for (int round = 0; round < 100; ++round) {
+        TCountDownLatch done(10);
+        {
+            auto invoker = New<TSerializedInvoker>(New<TInvoker>(New<TThreadPool>(2)));
+            for (int index = 0; index < 10; ++index) {
+                invoker->Invoke([&] {
+                    done.CountDown();
+                });
+            }
+        }
+        done.Wait();
+    }
+}
+
+} // namespace
+
+void RegisterSerializedInvokerTests(TTestRunner& runner) {
+    runner.Register("serialized_invoker/keeps_order_and_exclusion", KeepsOrderAndExclusion);
+    runner.Register("serialized_invoker/yields_after_drain_batch", YieldsAfterDrainBatch);
+    runner.Register("serialized_invoker/run_returns_future", RunReturnsFuture);
+    runner.Register("serialized_invoker/outlives_its_owner", OutlivesItsOwner);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NTest
@@ -0,0 +1,122 @@
+#include <tests/harness.h>
+
+#include <common/exception.h>
+#include <common/timer_wheel.h>
+
+#include <random>
+#include <vector>
+
+namespace NTest {
+
+using namespace NCommon;
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+TTimerEntryPtr MakeEntry(uint64_t deadlineTick) {
+    return New<TTimerEntry>(deadlineTick, TTask([] {}));
+}
+
+// Steps through the wheel by GetNextTick and checks that every entry comes out
+// exactly at its deadline, including those cascaded down from a higher level
+// onto the tick they are due at.
+void FiresAtDeadline() {
+    const std::vector<uint64_t> deadlines = {
+        1, 2, 255, 256, 257, 511, 512, 65535, 65536, 65537, 70000,
+        uint64_t(1) << 24, (uint64_t(1) << 24) + 1, uint64_t(1) << 32, (uint64_t(1) << 32) + 5,
+    };
+
+    TTimerWheel wheel;
+    for (auto deadline : deadlines) {
+        wheel.Insert(MakeEntry(deadline));
+    }
+    ASSERT(wheel.GetSize() == deadlines.size(), "size {} after inserting {}", wheel.GetSize(), deadlines.size());
+
+    size_t fired = 0;
+    while (wheel.GetSize() > 0) {
+        auto next = wheel.GetNextTick();
+        ASSERT(next, "no next tick with {} entries left", wheel.GetSize());
+
+        std::vector<TTimerEntryPtr> ready;
+        wheel.Advance(*next, &ready);
+        for (const auto& entry : ready) {
+            ASSERT(entry->GetDeadlineTick() == wheel.GetCurrentTick(),
+                "entry due at {} fired at {}", entry->GetDeadlineTick(), wheel.GetCurrentTick());
+        }
+        fired += ready.size();
+    }
+    ASSERT(fired == deadlines.size(), "{} of {} entries fired", fired, deadlines.size());
+    ASSERT(!wheel.GetNextTick(), "empty wheel has a next tick");
+}
+
+// Advances by random steps and checks every entry against the step its
+// deadline falls into.
+void MatchesReferenceOrder() {
+    std::mt19937_64 random(42);
+    std::uniform_int_distribution<uint64_t> deadlineDistribution(1, 200000);
+    std::uniform_int_distribution<uint64_t> stepDistribution(1, 3000);
+
+    TTimerWheel wheel;
+    for (int index = 0; index < 5000; ++index) {
+        wheel.Insert(MakeEntry(deadlineDistribution(random)));
+    }
+
+    uint64_t tick = 0;
+    size_t fired = 0;
+    while (wheel.GetSize() > 0) {
+        uint64_t previous = tick;
+        tick += stepDistribution(random);
+
+        std::vector<TTimerEntryPtr> ready;
+        wheel.Advance(tick, &ready);
+        ASSERT(wheel.GetCurrentTick() == tick, "wheel stopped at {} instead of {}", wheel.GetCurrentTick(), tick);
+        for (const auto& entry : ready) {
+            ASSERT(entry->GetDeadlineTick() > previous && entry->GetDeadlineTick() <= tick,
+                "entry due at {} fired in step ({}, {}]", entry->GetDeadlineTick(), previous, tick);
+        }
+        fired += ready.size();
+    }
+    ASSERT(fired == 5000, "{} of 5000 entries fired", fired);
+}
+
+void SkipsCancelledEntries() {
+    TTimerWheel wheel;
+    auto kept = MakeEntry(10);
+    auto cancelledNear = MakeEntry(10);
+    auto cancelledFar = MakeEntry(100000);
+    wheel.Insert(kept);
+    wheel.Insert(cancelledNear);
+    wheel.Insert(cancelledFar);
+    cancelledNear->Cancel();
+    cancelledFar->Cancel();
+
+    std::vector<TTimerEntryPtr> ready;
+    wheel.Advance(200000, &ready);
+    ASSERT(ready.size() == 1 && ready[0] == kept, "{} entries fired instead of the one not cancelled", ready.size());
+    ASSERT(wheel.GetSize() == 0, "cancelled entries still counted: {}", wheel.GetSize());
+}
+
+void PastDeadlineFiresOnNextTick() {
+    TTimerWheel wheel;
+    std::vector<TTimerEntryPtr> ready;
+    wheel.Advance(1000, &ready);
+
+    wheel.Insert(MakeEntry(10));
+    ASSERT(wheel.GetNextTick() == 1001u, "next tick is not the one after the current");
+    wheel.Advance(1001, &ready);
+    ASSERT(ready.size() == 1, "overdue entry did not fire on the next tick");
+}
+
+} // namespace
+
+void RegisterTimerWheelTests(TTestRunner& runner) {
+    runner.Register("timer_wheel/fires_at_deadline", FiresAtDeadline);
+    runner.Register("timer_wheel/matches_reference_order", MatchesReferenceOrder);
+    runner.Register("timer_wheel/skips_cancelled_entries", SkipsCancelledEntries);
+    runner.Register("timer_wheel/past_deadline_fires_on_next_tick", PastDeadlineFiresOnNextTick);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NTest